@@ -0,0 +1,659 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "archive.h"
+
+#define TAR_BLOCK 512
+#define TAR_MAX_HEADER (1 << 20)
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_END_SIZE 22
+#define ZIP_MAX_COMMENT 0xffff
+
+/* Member: a python member read from an archive, or still being inflated.
+ *
+ * @path: `archive!member`.
+ * @source: content of the member, NUL terminated, or NULL if it could not
+ *      be read.
+ * @entry: central directory entry of a zip member to inflate.
+ * @is_ready: whether source is set.
+ */
+typedef struct {
+    char *path;
+    char *source;
+    const unsigned char *entry;
+    bool is_ready;
+} Member;
+
+/* ArchiveReader: the members passed from the threads reading an archive to
+ * the thread visiting them.
+ *
+ * @path: path of the archive.
+ * @data, @size: the mapped zip archive.
+ * @members: ring of the members read or being inflated, but not visited
+ *      yet, in archive order.
+ * @first: index of the oldest member in the ring.
+ * @count: number of members in the ring.
+ * @unclaimed: number of zip members at the end of the ring that no thread
+ *      is inflating yet.
+ * @is_listed: whether every zip member to inflate is in the ring.
+ * @done: whether the reading threads are done with the archive.
+ */
+typedef struct {
+    const char *path;
+    const unsigned char *data;
+    size_t size;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_cond_t not_claimed;
+    Member members[ARCHIVE_QUEUE_SIZE];
+    int first;
+    int count;
+    int unclaimed;
+    bool is_listed;
+    bool done;
+} ArchiveReader;
+
+static bool hasSuffix(const char *name, const char *suffix) {
+    size_t len = strlen(name);
+    size_t suffix_len = strlen(suffix);
+    return len > suffix_len && !strcmp(name + len - suffix_len, suffix);
+}
+
+bool isArchive(const char *name) {
+    return hasSuffix(name, ".tar") || hasSuffix(name, ".tar.gz")
+        || hasSuffix(name, ".tgz") || hasSuffix(name, ".whl")
+        || hasSuffix(name, ".zip");
+}
+
+static void archiveError(ArchiveReader const *reader, const char *message,
+    const char *member)
+{
+    if (member)
+        fprintf(stderr, "error: %s \"%s!%s\".\n", message, reader->path, member);
+    else
+        fprintf(stderr, "error: %s \"%s\".\n", message, reader->path);
+}
+
+static void *allocate(ArchiveReader const *reader, size_t size) {
+    void *memory = malloc(size);
+    if (!memory) {
+        archiveError(reader, "not enough memory to read", NULL);
+        exit(74);
+    }
+    return memory;
+}
+
+/* queue a member, waiting for the visitor if the queue is full. a zip
+ * member is queued with its entry and no source, to be inflated by
+ * inflateMembers(). the source is owned by the queue from then on. */
+static void pushMember(ArchiveReader *reader, const char *name, char *source,
+    const unsigned char *entry)
+{
+    char *path = allocate(reader, strlen(reader->path) + strlen(name) + 2);
+    sprintf(path, "%s!%s", reader->path, name);
+
+    pthread_mutex_lock(&reader->lock);
+    while (reader->count == ARCHIVE_QUEUE_SIZE)
+        pthread_cond_wait(&reader->not_full, &reader->lock);
+    int last = (reader->first + reader->count) % ARCHIVE_QUEUE_SIZE;
+    reader->members[last] = (Member) {path, source, entry, entry == NULL};
+    ++reader->count;
+    if (entry) {
+        ++reader->unclaimed;
+        pthread_cond_signal(&reader->not_claimed);
+    } else {
+        pthread_cond_signal(&reader->not_empty);
+    }
+    pthread_mutex_unlock(&reader->lock);
+}
+
+/* take the next member once it is ready, returning false once the archive
+ * is exhausted. */
+static bool popMember(ArchiveReader *reader, Member *member) {
+    pthread_mutex_lock(&reader->lock);
+    while ((reader->count == 0 || !reader->members[reader->first].is_ready)
+        && !reader->done)
+    {
+        pthread_cond_wait(&reader->not_empty, &reader->lock);
+    }
+    bool found = reader->count > 0;
+    if (found) {
+        *member = reader->members[reader->first];
+        reader->first = (reader->first + 1) % ARCHIVE_QUEUE_SIZE;
+        --reader->count;
+        pthread_cond_signal(&reader->not_full);
+    }
+    pthread_mutex_unlock(&reader->lock);
+    return found;
+}
+
+/* parse a tar number field: octal digits, or GNU base-256 when the high bit
+ * of the first byte is set. */
+static uint64_t parseNumber(const unsigned char *field, int size) {
+    uint64_t value = 0;
+    int i = 0;
+    if (field[0] & 0x80) {
+        value = field[0] & 0x7f;
+        for (i = 1; i < size; ++i)
+            value = value << 8 | field[i];
+        return value;
+    }
+
+    while (i < size && field[i] == ' ')
+        ++i;
+    for (; i < size && field[i] >= '0' && field[i] <= '7'; ++i)
+        value = value << 3 | (field[i] - '0');
+    return value;
+}
+
+static bool isEndBlock(const unsigned char *header) {
+    for (int i = 0; i < TAR_BLOCK; ++i) {
+        if (header[i])
+            return false;
+    }
+    return true;
+}
+
+/* the checksum is the sum of the header bytes, counting its own field as
+ * spaces. */
+static bool isTarHeader(const unsigned char *header) {
+    uint64_t sum = 8 * ' ';
+    for (int i = 0; i < TAR_BLOCK; ++i) {
+        if (i < 148 || i >= 156)
+            sum += header[i];
+    }
+    return sum == parseNumber(header + 148, 8);
+}
+
+/* the member name of a header, with the ustar prefix if there is one. */
+static char *tarName(ArchiveReader const *reader, const unsigned char *header)
+{
+    const char *name = (const char *)header;
+    const char *prefix = (const char *)header + 345;
+    size_t name_len = strnlen(name, 100);
+    size_t prefix_len = memcmp(header + 257, "ustar", 5) ? 0
+        : strnlen(prefix, 155);
+
+    char *path = allocate(reader, prefix_len + name_len + 2);
+    if (prefix_len)
+        sprintf(path, "%.*s/%.*s", (int)prefix_len, prefix, (int)name_len, name);
+    else
+        sprintf(path, "%.*s", (int)name_len, name);
+    return path;
+}
+
+/* the path of a pax extended header, made of `LENGTH key=value\n` records,
+ * or NULL if it has none. */
+static char *paxPath(ArchiveReader const *reader, const char *text,
+    size_t size)
+{
+    const char *record = text;
+    while (record < text + size) {
+        char *key;
+        unsigned long length = strtoul(record, &key, 10);
+        if (*key != ' ' || length == 0 || length > size - (record - text))
+            break;
+
+        ++key;
+        const char *end = record + length - 1;
+        if (end - key > 5 && !memcmp(key, "path=", 5)) {
+            char *path = allocate(reader, end - key - 4);
+            memcpy(path, key + 5, end - key - 5);
+            path[end - key - 5] = '\0';
+            return path;
+        }
+        record += length;
+    }
+    return NULL;
+}
+
+/* inflate and drop the next bytes of a tar stream, failing if it ends
+ * first, which gzseek() would not tell. */
+static bool discardTarData(gzFile file, uint64_t size) {
+    char buffer[32 * TAR_BLOCK];
+    while (size > 0) {
+        unsigned chunk = size < sizeof(buffer) ? size : sizeof(buffer);
+        if (gzread(file, buffer, chunk) != (int)chunk)
+            return false;
+        size -= chunk;
+    }
+    return true;
+}
+
+/* read the data of a member and skip the padding to the next header. */
+static bool readTarData(gzFile file, char *buffer, uint64_t size) {
+    uint64_t padding = -size % TAR_BLOCK;
+    return gzread(file, buffer, size) == (int)size
+        && discardTarData(file, padding);
+}
+
+static bool skipTarData(gzFile file, uint64_t size) {
+    return discardTarData(file, size + -size % TAR_BLOCK);
+}
+
+/* tar members are read from a gzip stream, plain tar files passing through
+ * zlib untouched. members that are not needed are inflated and dropped on
+ * the way to the next header. */
+static void readTar(ArchiveReader *reader) {
+    gzFile file = gzopen(reader->path, "rb");
+    if (!file) {
+        archiveError(reader, "could not open file", NULL);
+        return;
+    }
+    gzbuffer(file, 1 << 17);
+
+    unsigned char header[TAR_BLOCK];
+    char *long_name = NULL;
+    for (;;) {
+        int read = gzread(file, header, TAR_BLOCK);
+        int error = Z_OK;
+        if (read == 0)
+            gzerror(file, &error);
+        if (error != Z_OK) {
+            archiveError(reader, "truncated archive", NULL);
+            break;
+        }
+        if (read == 0 || (read == TAR_BLOCK && isEndBlock(header)))
+            break;
+        if (read != TAR_BLOCK || !isTarHeader(header)) {
+            archiveError(reader, "corrupt tar header in", NULL);
+            break;
+        }
+
+        uint64_t size = parseNumber(header + 124, 12);
+        char type = header[156];
+        if (type == 'L' || type == 'x') {
+            // the name of the next member, when too long for the header.
+            if (size > TAR_MAX_HEADER) {
+                archiveError(reader, "oversized tar header in", NULL);
+                break;
+            }
+            char *text = allocate(reader, size + 1);
+            if (!readTarData(file, text, size)) {
+                free(text);
+                archiveError(reader, "truncated tar header in", NULL);
+                break;
+            }
+            text[size] = '\0';
+
+            char *name = type == 'L' ? text : paxPath(reader, text, size);
+            if (name != text)
+                free(text);
+            if (name) {
+                free(long_name);
+                long_name = name;
+            }
+            continue;
+        }
+
+        char *name = long_name ? long_name : tarName(reader, header);
+        long_name = NULL;
+
+        bool is_python = (type == '0' || type == '\0' || type == '7')
+            && isPythonFile(name);
+        if (is_python && size > ARCHIVE_MAX_MEMBER) {
+            archiveError(reader, "skipping oversized member", name);
+            is_python = false;
+        }
+
+        bool ok;
+        if (is_python) {
+            char *source = allocate(reader, size + 1);
+            ok = readTarData(file, source, size);
+            if (ok) {
+                source[size] = '\0';
+                pushMember(reader, name, source, NULL);
+            } else {
+                free(source);
+            }
+        } else {
+            ok = skipTarData(file, size);
+        }
+
+        if (!ok) {
+            archiveError(reader, "truncated member", name);
+            free(name);
+            break;
+        }
+        free(name);
+    }
+
+    free(long_name);
+    gzclose(file);
+}
+
+static uint32_t read16(const unsigned char *bytes) {
+    return bytes[0] | bytes[1] << 8;
+}
+
+static uint32_t read32(const unsigned char *bytes) {
+    return read16(bytes) | (uint32_t)read16(bytes + 2) << 16;
+}
+
+static uint64_t read64(const unsigned char *bytes) {
+    return read32(bytes) | (uint64_t)read32(bytes + 4) << 32;
+}
+
+/* the end of central directory record, searched backwards past the
+ * archive comment. */
+static const unsigned char *findZipEnd(const unsigned char *data, size_t size)
+{
+    if (size < ZIP_END_SIZE)
+        return NULL;
+
+    size_t last = size - ZIP_END_SIZE;
+    size_t first = last > ZIP_MAX_COMMENT ? last - ZIP_MAX_COMMENT : 0;
+    for (size_t i = last + 1; i-- > first;) {
+        if (read32(data + i) == 0x06054b50)
+            return data + i;
+    }
+    return NULL;
+}
+
+/* replace the sizes and offset saturated in a central directory entry by
+ * their values in the zip64 extra field. */
+static void readZip64Extra(const unsigned char *extra, size_t extra_len,
+    uint64_t *compressed, uint64_t *length, uint64_t *offset)
+{
+    while (extra_len >= 4) {
+        uint32_t id = read16(extra);
+        uint32_t size = read16(extra + 2);
+        if (size > extra_len - 4)
+            return;
+
+        if (id == 0x0001) {
+            const unsigned char *field = extra + 4;
+            const unsigned char *end = field + size;
+            uint64_t *values[] = {length, compressed, offset};
+            for (int i = 0; i < 3; ++i) {
+                if (*values[i] == 0xffffffff && end - field >= 8) {
+                    *values[i] = read64(field);
+                    field += 8;
+                }
+            }
+            return;
+        }
+
+        extra += 4 + size;
+        extra_len -= 4 + size;
+    }
+}
+
+/* inflate one member given its central directory entry, returning its
+ * source or NULL. */
+static char *readZipMember(ArchiveReader const *reader,
+    const unsigned char *entry, const char *name)
+{
+    const unsigned char *data = reader->data;
+    size_t size = reader->size;
+    uint32_t flags = read16(entry + 8);
+    uint32_t method = read16(entry + 10);
+    uint32_t crc = read32(entry + 16);
+    uint64_t compressed = read32(entry + 20);
+    uint64_t length = read32(entry + 24);
+    uint64_t offset = read32(entry + 42);
+    readZip64Extra(entry + ZIP_CENTRAL_SIZE + read16(entry + 28),
+        read16(entry + 30), &compressed, &length, &offset);
+
+    if (flags & 1) {
+        archiveError(reader, "skipping encrypted member", name);
+        return NULL;
+    }
+    if (method != 0 && method != Z_DEFLATED) {
+        archiveError(reader, "unsupported compression for member", name);
+        return NULL;
+    }
+    if (length > ARCHIVE_MAX_MEMBER || compressed > UINT_MAX) {
+        archiveError(reader, "skipping oversized member", name);
+        return NULL;
+    }
+
+    const unsigned char *local = data + offset;
+    if (size < ZIP_LOCAL_SIZE || offset > size - ZIP_LOCAL_SIZE
+        || read32(local) != 0x04034b50)
+    {
+        archiveError(reader, "corrupt local header for member", name);
+        return NULL;
+    }
+    uint64_t start = offset + ZIP_LOCAL_SIZE + read16(local + 26)
+        + read16(local + 28);
+    if (start > size || compressed > size - start) {
+        archiveError(reader, "truncated member", name);
+        return NULL;
+    }
+
+    char *source = allocate(reader, length + 1);
+    bool ok;
+    if (method == 0) {
+        ok = compressed == length;
+        if (ok)
+            memcpy(source, data + start, length);
+    } else {
+        z_stream stream = {
+            .next_in = (Bytef *)(data + start),
+            .avail_in = compressed,
+            .next_out = (Bytef *)source,
+            .avail_out = length + 1
+        };
+        ok = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+        if (ok) {
+            ok = inflate(&stream, Z_FINISH) == Z_STREAM_END
+                && stream.total_out == length;
+            inflateEnd(&stream);
+        }
+    }
+
+    if (!ok || crc32(0, (const Bytef *)source, length) != crc) {
+        archiveError(reader, "could not inflate member", name);
+        free(source);
+        return NULL;
+    }
+    source[length] = '\0';
+    return source;
+}
+
+/* inflate the zip members queued, in the order they were, until all of
+ * them are claimed. */
+static void *inflateMembers(void *data) {
+    ArchiveReader *reader = data;
+    size_t prefix = strlen(reader->path) + 1;
+
+    pthread_mutex_lock(&reader->lock);
+    for (;;) {
+        while (reader->unclaimed == 0 && !reader->is_listed)
+            pthread_cond_wait(&reader->not_claimed, &reader->lock);
+        if (reader->unclaimed == 0)
+            break;
+
+        // the member stays in its slot until it is ready, so the slot can
+        // be filled once inflated.
+        int slot = (reader->first + reader->count - reader->unclaimed)
+            % ARCHIVE_QUEUE_SIZE;
+        --reader->unclaimed;
+        Member member = reader->members[slot];
+        pthread_mutex_unlock(&reader->lock);
+
+        char *source = readZipMember(reader, member.entry,
+            member.path + prefix);
+
+        pthread_mutex_lock(&reader->lock);
+        reader->members[slot].source = source;
+        reader->members[slot].is_ready = true;
+        if (slot == reader->first)
+            pthread_cond_signal(&reader->not_empty);
+    }
+    pthread_mutex_unlock(&reader->lock);
+    return NULL;
+}
+
+/* start the threads inflating zip members, one per processor besides the
+ * one visiting them, returning how many were started. */
+static int startInflating(ArchiveReader *reader, pthread_t *threads) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int count = cpus > 2 ? (int)cpus - 1 : 1;
+    if (count > ARCHIVE_QUEUE_SIZE)
+        count = ARCHIVE_QUEUE_SIZE;
+
+    for (int i = 0; i < count; ++i) {
+        if (pthread_create(&threads[i], NULL, inflateMembers, reader)) {
+            if (i == 0) {
+                archiveError(reader, "could not start a thread to read",
+                    NULL);
+                exit(74);
+            }
+            return i;
+        }
+    }
+    return count;
+}
+
+/* zip archives are mapped and walked through their central directory, so
+ * only the python members are ever inflated, each on whichever inflating
+ * thread is free. */
+static void readZip(ArchiveReader *reader) {
+    int fd = open(reader->path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+        archiveError(reader, "could not open file", NULL);
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    size_t size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        archiveError(reader, "could not map file", NULL);
+        return;
+    }
+    const unsigned char *data = map;
+
+    const unsigned char *end_record = findZipEnd(data, size);
+    if (!end_record) {
+        archiveError(reader, "no zip central directory in", NULL);
+        munmap(map, size);
+        return;
+    }
+
+    uint64_t entries = read16(end_record + 10);
+    uint64_t directory_size = read32(end_record + 12);
+    uint64_t directory = read32(end_record + 16);
+    // zip64 archives keep the real values in a record found by a locator.
+    if (end_record - data >= 20 && read32(end_record - 20) == 0x07064b50) {
+        uint64_t record = read64(end_record - 20 + 8);
+        if (size >= 56 && record <= size - 56
+            && read32(data + record) == 0x06064b50)
+        {
+            entries = read64(data + record + 32);
+            directory_size = read64(data + record + 40);
+            directory = read64(data + record + 48);
+        }
+    }
+
+    if (directory > size || directory_size > size - directory) {
+        archiveError(reader, "corrupt zip central directory in", NULL);
+        munmap(map, size);
+        return;
+    }
+
+    reader->data = data;
+    reader->size = size;
+    pthread_t inflaters[ARCHIVE_QUEUE_SIZE];
+    int inflaters_count = startInflating(reader, inflaters);
+
+    const unsigned char *entry = data + directory;
+    const unsigned char *end = entry + directory_size;
+    for (uint64_t i = 0; i < entries; ++i) {
+        if (end - entry < ZIP_CENTRAL_SIZE || read32(entry) != 0x02014b50) {
+            archiveError(reader, "corrupt zip central directory in", NULL);
+            break;
+        }
+        size_t name_len = read16(entry + 28);
+        size_t entry_size = ZIP_CENTRAL_SIZE + name_len + read16(entry + 30)
+            + read16(entry + 32);
+        if ((size_t)(end - entry) < entry_size) {
+            archiveError(reader, "corrupt zip central directory in", NULL);
+            break;
+        }
+
+        const char *name = (const char *)entry + ZIP_CENTRAL_SIZE;
+        if (name_len > 3 && !memcmp(name + name_len - 3, ".py", 3)) {
+            char *member = strndup(name, name_len);
+            if (!member) {
+                archiveError(reader, "not enough memory to read", NULL);
+                exit(74);
+            }
+            pushMember(reader, member, NULL, entry);
+            free(member);
+        }
+
+        entry += entry_size;
+    }
+
+    pthread_mutex_lock(&reader->lock);
+    reader->is_listed = true;
+    pthread_cond_broadcast(&reader->not_claimed);
+    pthread_mutex_unlock(&reader->lock);
+    for (int i = 0; i < inflaters_count; ++i)
+        pthread_join(inflaters[i], NULL);
+
+    munmap(map, size);
+}
+
+static void *readArchive(void *data) {
+    ArchiveReader *reader = data;
+    if (hasSuffix(reader->path, ".whl") || hasSuffix(reader->path, ".zip"))
+        readZip(reader);
+    else
+        readTar(reader);
+
+    pthread_mutex_lock(&reader->lock);
+    reader->done = true;
+    pthread_cond_signal(&reader->not_empty);
+    pthread_mutex_unlock(&reader->lock);
+    return NULL;
+}
+
+void walkArchive(const char *path, VisitFunc visit, void *data) {
+    ArchiveReader reader = {.path = path};
+    pthread_mutex_init(&reader.lock, NULL);
+    pthread_cond_init(&reader.not_empty, NULL);
+    pthread_cond_init(&reader.not_full, NULL);
+    pthread_cond_init(&reader.not_claimed, NULL);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, readArchive, &reader)) {
+        fprintf(stderr, "error: could not start a thread to read \"%s\".\n",
+            path);
+        exit(74);
+    }
+
+    Member member;
+    while (popMember(&reader, &member)) {
+        if (member.source)
+            visit(member.path, member.source, data);
+        free(member.path);
+        free(member.source);
+    }
+
+    pthread_join(thread, NULL);
+    pthread_cond_destroy(&reader.not_claimed);
+    pthread_cond_destroy(&reader.not_full);
+    pthread_cond_destroy(&reader.not_empty);
+    pthread_mutex_destroy(&reader.lock);
+}
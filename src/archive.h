@@ -0,0 +1,37 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdbool.h>
+
+#include "walk.h"
+
+/* size of the queue of members read ahead of the visitor. */
+#define ARCHIVE_QUEUE_SIZE 16
+
+/* members larger than this are skipped rather than read in memory. */
+#define ARCHIVE_MAX_MEMBER (256 << 20)
+
+/* isArchive: whether a name ends with `.tar`, `.tar.gz`, `.tgz`, `.whl` or
+ * `.zip`.
+ */
+bool isArchive(const char *name);
+
+/* walkArchive: visit the python members of an archive, without extracting it.
+ *
+ * tar archives, compressed with gzip or not, are inflated as a stream and
+ * members other than `.py` files are skipped over without being kept. zip
+ * archives and wheels are mapped and only their `.py` members are inflated.
+ * members are read and inflated in memory a few ahead of the thread visiting
+ * them, so that inflating and scanning overlap: a tar stream by a separate
+ * thread, and zip members by one thread per processor but one, each taking
+ * the next member queued, so that large zip archives are not inflated on a
+ * single core.
+ *
+ * @path: path of the archive.
+ * @visit: function called with each python member in archive order, named
+ *      `path!member`.
+ * @data: passed through to visit.
+ */
+void walkArchive(const char *path, VisitFunc visit, void *data);
+
+#endif
@@ -0,0 +1,304 @@
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+
+#define CHECKPOINT_MAGIC "PTCI"
+
+static void *growArray(void *array, int *capacity, size_t item_size) {
+    *capacity = *capacity < 8 ? 8 : *capacity * 2;
+    array = realloc(array, *capacity * item_size);
+    if (!array) {
+        fprintf(stderr, "error: not enough memory for the checkpoint index.\n");
+        exit(74);
+    }
+    return array;
+}
+
+void initCheckpointIndex(CheckpointIndex *index, const char *source,
+    int interval)
+{
+    index->source = source;
+    index->interval = interval > 0 ? interval : 1;
+    index->lines = 0;
+    index->count = 0;
+    index->capacity = 0;
+    index->checkpoints = NULL;
+    index->stacks_count = 0;
+    index->stacks_capacity = 0;
+    index->indents = NULL;
+    index->altindents = NULL;
+}
+
+void freeCheckpointIndex(CheckpointIndex *index) {
+    free(index->checkpoints);
+    free(index->indents);
+    free(index->altindents);
+    initCheckpointIndex(index, index->source, index->interval);
+}
+
+static void reserveStacks(CheckpointIndex *index, int count) {
+    int capacity = index->stacks_capacity;
+    while (index->stacks_count + count > capacity)
+        capacity = capacity < 8 ? 8 : capacity * 2;
+    if (capacity == index->stacks_capacity)
+        return;
+
+    index->indents = realloc(index->indents, capacity * sizeof(int));
+    index->altindents = realloc(index->altindents, capacity * sizeof(int));
+    if (!index->indents || !index->altindents) {
+        fprintf(stderr, "error: not enough memory for the checkpoint index.\n");
+        exit(74);
+    }
+    index->stacks_capacity = capacity;
+}
+
+void indexLine(CheckpointIndex *index, Scanner const *scnr) {
+    if (++index->lines % index->interval != 0)
+        return;
+
+    if (index->count == index->capacity) {
+        index->checkpoints = growArray(index->checkpoints, &index->capacity,
+            sizeof(Checkpoint));
+    }
+
+    int depth = scnr->indent + 1;
+    reserveStacks(index, depth);
+    memcpy(index->indents + index->stacks_count, scnr->indents,
+        depth * sizeof(int));
+    memcpy(index->altindents + index->stacks_count, scnr->altindents,
+        depth * sizeof(int));
+
+    index->checkpoints[index->count++] = (Checkpoint) {
+        .offset = (int)(scnr->current - index->source),
+        .line = scnr->current_line,
+        .level = scnr->level,
+        .indent = scnr->indent,
+        .pending_dedents = scnr->pending_dedents,
+        .stack = index->stacks_count
+    };
+    index->stacks_count += depth;
+}
+
+void buildCheckpointIndex(CheckpointIndex *index) {
+    Scanner scanner;
+    initScanner(&scanner, index->source);
+
+    for (;;) {
+        Token token = scanToken(&scanner);
+
+        switch (token.type) {
+            case TOKEN_ENDMARKER:
+                return;
+            case TOKEN_NEWLINE:
+                indexLine(index, &scanner);
+                break;
+            case TOKEN_INDENT:
+            case TOKEN_DEDENT:
+                break;
+            default:
+                // only the tokens that delimit logical lines matter.
+                skipStatement(&scanner);
+                break;
+        }
+    }
+}
+
+void seekLine(Scanner *scnr, CheckpointIndex const *index, int line) {
+    initScanner(scnr, index->source);
+
+    // find the last checkpoint at or before the line.
+    int low = 0, high = index->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (index->checkpoints[mid].line <= line)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low == 0)
+        return;
+
+    Checkpoint const *checkpoint = &index->checkpoints[low - 1];
+    int depth = checkpoint->indent + 1;
+
+    scnr->start = scnr->current = index->source + checkpoint->offset;
+    scnr->start_line = scnr->current_line = checkpoint->line;
+    scnr->level = checkpoint->level;
+    scnr->indent = checkpoint->indent;
+    scnr->pending_dedents = checkpoint->pending_dedents;
+    memcpy(scnr->indents, index->indents + checkpoint->stack,
+        depth * sizeof(int));
+    memcpy(scnr->altindents, index->altindents + checkpoint->stack,
+        depth * sizeof(int));
+}
+
+void tokenizeRange(CheckpointIndex const *index, int first, int last,
+    TokenFunc func, void *data)
+{
+    Scanner scanner;
+    seekLine(&scanner, index, first);
+
+    for (;;) {
+        Token token = scanToken(&scanner);
+        if (token.type == TOKEN_ENDMARKER || token.line > last)
+            break;
+
+        // the scanner is on the last line of the token once it is scanned,
+        // except for newlines which end on the line after.
+        int end_line = token.type == TOKEN_NEWLINE
+            ? token.line : scanner.current_line;
+        if (end_line >= first)
+            func(token, data);
+    }
+}
+
+/* serialization: all fields are written as 32-bit little endian integers,
+ * except for the source hash which is 64-bit. */
+
+static uint64_t hashSource(const char *source, size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)source[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static bool writeU32(FILE *file, uint32_t value) {
+    unsigned char bytes[4] = {
+        value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, value >> 24
+    };
+    return fwrite(bytes, 1, 4, file) == 4;
+}
+
+static bool readU32(FILE *file, uint32_t *value) {
+    unsigned char bytes[4];
+    if (fread(bytes, 1, 4, file) != 4)
+        return false;
+    *value = bytes[0] | (uint32_t)bytes[1] << 8
+        | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    return true;
+}
+
+static bool writeU64(FILE *file, uint64_t value) {
+    return writeU32(file, value & 0xffffffffu) && writeU32(file, value >> 32);
+}
+
+static bool readU64(FILE *file, uint64_t *value) {
+    uint32_t low, high;
+    if (!readU32(file, &low) || !readU32(file, &high))
+        return false;
+    *value = (uint64_t)high << 32 | low;
+    return true;
+}
+
+bool writeCheckpointIndex(CheckpointIndex const *index, FILE *file) {
+    size_t length = strlen(index->source);
+    bool ok = fwrite(CHECKPOINT_MAGIC, 1, 4, file) == 4
+        && writeU32(file, CHECKPOINT_VERSION)
+        && writeU32(file, index->interval)
+        && writeU32(file, index->lines)
+        && writeU32(file, (uint32_t)length)
+        && writeU64(file, hashSource(index->source, length))
+        && writeU32(file, index->count)
+        && writeU32(file, index->stacks_count);
+
+    for (int i = 0; ok && i < index->count; ++i) {
+        Checkpoint const *checkpoint = &index->checkpoints[i];
+        ok = writeU32(file, checkpoint->offset)
+            && writeU32(file, checkpoint->line)
+            && writeU32(file, checkpoint->level)
+            && writeU32(file, checkpoint->indent)
+            && writeU32(file, checkpoint->pending_dedents)
+            && writeU32(file, checkpoint->stack);
+    }
+
+    for (int i = 0; ok && i < index->stacks_count; ++i) {
+        ok = writeU32(file, index->indents[i])
+            && writeU32(file, index->altindents[i]);
+    }
+
+    return ok;
+}
+
+static bool readCheckpoints(CheckpointIndex *index, FILE *file) {
+    char magic[4];
+    uint32_t version, interval, lines, length, count, stacks_count;
+    uint64_t hash;
+
+    if (fread(magic, 1, 4, file) != 4
+        || memcmp(magic, CHECKPOINT_MAGIC, 4)
+        || !readU32(file, &version) || version != CHECKPOINT_VERSION
+        || !readU32(file, &interval) || !readU32(file, &lines)
+        || !readU32(file, &length) || !readU64(file, &hash)
+        || !readU32(file, &count) || !readU32(file, &stacks_count))
+        return false;
+
+    size_t source_length = strlen(index->source);
+    if (length != source_length
+        || hash != hashSource(index->source, source_length)
+        || interval == 0 || interval > INT_MAX
+        || count > length + 1
+        || stacks_count > (uint64_t)count * MAX_INDENT)
+        return false;
+
+    index->interval = interval;
+    index->lines = lines;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t fields[6];
+        for (int j = 0; j < 6; ++j) {
+            if (!readU32(file, &fields[j]))
+                return false;
+        }
+
+        Checkpoint checkpoint = {
+            .offset = fields[0], .line = fields[1], .level = fields[2],
+            .indent = fields[3], .pending_dedents = fields[4],
+            .stack = fields[5]
+        };
+        if (checkpoint.offset < 0 || (size_t)checkpoint.offset > length
+            || checkpoint.indent < 0 || checkpoint.indent >= MAX_INDENT
+            || checkpoint.pending_dedents < 0
+            || checkpoint.pending_dedents >= MAX_INDENT - checkpoint.indent
+            || checkpoint.level < 0 || (size_t)checkpoint.level > length
+            || checkpoint.stack < 0
+            || (uint32_t)checkpoint.stack + checkpoint.indent >= stacks_count
+            || (index->count > 0 && checkpoint.line
+                < index->checkpoints[index->count - 1].line))
+            return false;
+
+        if (index->count == index->capacity) {
+            index->checkpoints = growArray(index->checkpoints,
+                &index->capacity, sizeof(Checkpoint));
+        }
+        index->checkpoints[index->count++] = checkpoint;
+    }
+
+    reserveStacks(index, stacks_count);
+    for (uint32_t i = 0; i < stacks_count; ++i) {
+        uint32_t indent, altindent;
+        if (!readU32(file, &indent) || !readU32(file, &altindent))
+            return false;
+        index->indents[i] = indent;
+        index->altindents[i] = altindent;
+    }
+    index->stacks_count = stacks_count;
+
+    return true;
+}
+
+bool readCheckpointIndex(CheckpointIndex *index, FILE *file) {
+    int interval = index->interval;
+    if (readCheckpoints(index, file))
+        return true;
+
+    freeCheckpointIndex(index);
+    index->interval = interval;
+    return false;
+}
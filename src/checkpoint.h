@@ -0,0 +1,112 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+
+#include "scanner.h"
+
+#define CHECKPOINT_VERSION 1
+
+/* Checkpoint: scanner state at the start of a logical line.
+ *
+ * @offset: offset of the line start in the source.
+ * @line: line number of the line start.
+ * @level: bracket level.
+ * @indent: last pushed indent index.
+ * @pending_dedents: number of dedents pending to be emitted.
+ * @stack: index of the first of the indent + 1 entries saved in the
+ *      indents and altindents of the index.
+ */
+typedef struct {
+    int offset;
+    int line;
+    int level;
+    int indent;
+    int pending_dedents;
+    int stack;
+} Checkpoint;
+
+/* CheckpointIndex: scanner checkpoints taken every few logical lines.
+ *
+ * @source: the indexed source string.
+ * @interval: number of logical lines between checkpoints.
+ * @lines: number of logical lines seen while building the index.
+ * @checkpoints: checkpoints in source order.
+ * @indents: saved indents of every checkpoint, each only as deep as the
+ *      indent stack of its checkpoint.
+ * @altindents: saved altindents, parallel to indents.
+ */
+typedef struct {
+    const char *source;
+    int interval;
+    int lines;
+    int count;
+    int capacity;
+    Checkpoint *checkpoints;
+    int stacks_count;
+    int stacks_capacity;
+    int *indents;
+    int *altindents;
+} CheckpointIndex;
+
+/* TokenFunc: called for each token by tokenizeRange(). */
+typedef void (*TokenFunc)(Token token, void *data);
+
+/* initCheckpointIndex: initialize an empty index.
+ *
+ * @source: the source string to index, it must outlive the index.
+ * @interval: number of logical lines between checkpoints.
+ */
+void initCheckpointIndex(CheckpointIndex *index, const char *source,
+    int interval);
+
+/* freeCheckpointIndex: free the memory held by an index. */
+void freeCheckpointIndex(CheckpointIndex *index);
+
+/* indexLine: record a logical line in the index.
+ *
+ * call this after each NEWLINE token returned by a scanner over the indexed
+ * source to build the index during a full scan. every interval lines a
+ * checkpoint of the scanner is taken.
+ */
+void indexLine(CheckpointIndex *index, Scanner const *scanner);
+
+/* buildCheckpointIndex: build an index with a fast pre-pass.
+ *
+ * scan the source of an empty index skipping over the body of every
+ * statement, recording logical lines as they are found.
+ */
+void buildCheckpointIndex(CheckpointIndex *index);
+
+/* seekLine: restore the scanner to the last checkpoint at or before a line.
+ *
+ * the scanner is initialized over the indexed source from the nearest
+ * checkpoint, or from the start if there is none.
+ */
+void seekLine(Scanner *scanner, CheckpointIndex const *index, int line);
+
+/* tokenizeRange: tokenize the given lines of the indexed source.
+ *
+ * call func for each token that lies within lines first to last, both
+ * included, including tokens spanning into the range from before it. only
+ * the lines from the nearest checkpoint on are scanned.
+ */
+void tokenizeRange(CheckpointIndex const *index, int first, int last,
+    TokenFunc func, void *data);
+
+/* writeCheckpointIndex: serialize an index to a file.
+ *
+ * returns false on write errors.
+ */
+bool writeCheckpointIndex(CheckpointIndex const *index, FILE *file);
+
+/* readCheckpointIndex: deserialize an index from a file.
+ *
+ * @index: an empty index initialized over the source that was indexed.
+ *
+ * returns false if the file is not a valid index or was built from a
+ * different source, in which case the index is left empty.
+ */
+bool readCheckpointIndex(CheckpointIndex *index, FILE *file);
+
+#endif
@@ -0,0 +1,173 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "client.h"
+#include "serve.h"
+
+int connectServer(const char *socket_path) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int connection = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (connection < 0)
+        return -1;
+    if (connect(connection, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        int error = errno;
+        close(connection);
+        errno = error;
+        return -1;
+    }
+    return connection;
+}
+
+int mapResult(int fd, size_t size, ServeResult *result) {
+    if (size < sizeof(ServeResultHeader)) {
+        close(fd);
+        return EPROTO;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return errno;
+
+    ServeResultHeader const *header = map;
+    size_t array_size = (size_t)header->count * sizeof(int32_t);
+    if (memcmp(header->magic, SERVE_RESULT_MAGIC, sizeof(header->magic))
+        || size != sizeof(*header) + 5 * array_size + header->messages_size)
+    {
+        munmap(map, size);
+        return EPROTO;
+    }
+
+    const int32_t *arrays = (const int32_t *)(header + 1);
+    *result = (ServeResult) {
+        .count = header->count,
+        .types = arrays,
+        .offsets = arrays + header->count,
+        .lengths = arrays + 2 * header->count,
+        .lines = arrays + 3 * header->count,
+        .columns = arrays + 4 * header->count,
+        .messages = (const char *)(arrays + 5 * header->count),
+        .messages_size = header->messages_size,
+        .map = map,
+        .size = size
+    };
+    return 0;
+}
+
+void freeServeResult(ServeResult *result) {
+    if (result->map)
+        munmap(result->map, result->size);
+    result->map = NULL;
+}
+
+/* send a request, passing fd if it is not -1, and wait for the result. */
+static int sendRequest(int connection, ServeKind kind, const char *path,
+    uint64_t length, int fd, ServeResult *result)
+{
+    ServeRequest request = {
+        .version = SERVE_VERSION,
+        .kind = kind,
+        .length = length
+    };
+    struct iovec parts[] = {
+        {&request, sizeof(request)},
+        {(void *)path, path ? length : 0}
+    };
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr message = {
+        .msg_iov = parts,
+        .msg_iovlen = 2
+    };
+
+    if (fd >= 0) {
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    if (sendmsg(connection, &message, MSG_NOSIGNAL) < 0)
+        return errno;
+
+    ServeResponse response;
+    struct iovec iov = {&response, sizeof(response)};
+    message = (struct msghdr) {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer)
+    };
+    ssize_t size = recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+    if (size < 0)
+        return errno;
+
+    int result_fd = -1;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET
+        && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+        memcpy(&result_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    if (size != sizeof(response) || response.status || result_fd < 0) {
+        if (result_fd >= 0)
+            close(result_fd);
+        return size != sizeof(response) ? EPROTO
+            : response.status ? (int)response.status : EPROTO;
+    }
+
+    return mapResult(result_fd, response.size, result);
+}
+
+int tokenizePath(int connection, const char *path, ServeResult *result) {
+    return sendRequest(connection, SERVE_PATH, path, strlen(path), -1, result);
+}
+
+int tokenizeSource(int connection, const char *source, size_t length,
+    ServeResult *result)
+{
+    int fd = memfd_create("pytokenize-source", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+        return errno;
+
+    // the trailing NUL and the seals let the daemon scan the memfd in place.
+    struct iovec parts[] = {
+        {(void *)source, length},
+        {"", 1}
+    };
+    int error = 0;
+    if (writev(fd, parts, 2) != (ssize_t)(length + 1))
+        error = errno ? errno : EIO;
+    else if (fcntl(fd, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_SHRINK
+        | F_SEAL_GROW | F_SEAL_SEAL) < 0)
+    {
+        error = errno;
+    }
+
+    if (!error)
+        error = sendRequest(connection, SERVE_MEMFD, NULL, length, fd, result);
+    close(fd);
+    return error;
+}
@@ -0,0 +1,61 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ServeResult: the tokens of a daemon response, mapped read-only.
+ *
+ * @count: number of tokens.
+ * @types, @offsets, @lengths, @lines, @columns: the tokens, as in
+ *      pytokTokenize().
+ * @messages: message of each error token, NUL terminated, in token order.
+ * @messages_size: size of messages.
+ * @map: the mapped result.
+ * @size: size of the mapping.
+ */
+typedef struct {
+    uint32_t count;
+    const int32_t *types;
+    const int32_t *offsets;
+    const int32_t *lengths;
+    const int32_t *lines;
+    const int32_t *columns;
+    const char *messages;
+    uint32_t messages_size;
+    void *map;
+    size_t size;
+} ServeResult;
+
+/* connectServer: connect to the daemon, returning the socket or -1. */
+int connectServer(const char *socket_path);
+
+/* tokenizePath: have the daemon tokenize a file.
+ *
+ * @connection: a socket from connectServer().
+ * @path: path of the file, as seen by the daemon.
+ *
+ * returns 0 and fills result on success, otherwise returns an errno value.
+ */
+int tokenizePath(int connection, const char *path, ServeResult *result);
+
+/* tokenizeSource: have the daemon tokenize a source buffer.
+ *
+ * the source is copied into a sealed memfd passed to the daemon, which
+ * tokenizes it in place.
+ *
+ * returns 0 and fills result on success, otherwise returns an errno value.
+ */
+int tokenizeSource(int connection, const char *source, size_t length,
+    ServeResult *result);
+
+/* mapResult: map a result memfd of the given size, taking over the fd.
+ *
+ * returns 0 on success, otherwise an errno value.
+ */
+int mapResult(int fd, size_t size, ServeResult *result);
+
+/* freeServeResult: unmap a result. */
+void freeServeResult(ServeResult *result);
+
+#endif
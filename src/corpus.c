@@ -0,0 +1,608 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "corpus.h"
+
+static void *reserveCorpus(void *array, uint64_t *capacity, uint64_t count,
+    size_t item_size)
+{
+    if (count <= *capacity)
+        return array;
+
+    uint64_t new_capacity = *capacity < 64 ? 64 : *capacity;
+    while (new_capacity < count)
+        new_capacity *= 2;
+    array = realloc(array, new_capacity * item_size);
+    if (!array) {
+        fprintf(stderr, "error: not enough memory for the corpus.\n");
+        exit(74);
+    }
+    *capacity = new_capacity;
+    return array;
+}
+
+void initCorpus(Corpus *corpus, const char *directory, uint32_t flags,
+    uint64_t shard_tokens)
+{
+    memset(corpus, 0, sizeof(Corpus));
+    corpus->directory = directory;
+    corpus->flags = flags;
+    corpus->shard_tokens = shard_tokens > 0 ? shard_tokens : 1;
+    pthread_mutex_init(&corpus->lock, NULL);
+    pthread_cond_init(&corpus->not_empty, NULL);
+    pthread_cond_init(&corpus->not_full, NULL);
+    pthread_cond_init(&corpus->turn, NULL);
+
+    // id 0 is the empty lexeme.
+    corpus->offsets = reserveCorpus(NULL, &corpus->offsets_capacity, 1,
+        sizeof(uint64_t));
+    corpus->lexeme_hashes = malloc(corpus->offsets_capacity * sizeof(uint64_t));
+    if (!corpus->lexeme_hashes) {
+        fprintf(stderr, "error: not enough memory for the corpus.\n");
+        exit(74);
+    }
+    corpus->offsets[0] = 0;
+    corpus->lexeme_hashes[0] = 0;
+    corpus->count = 1;
+}
+
+void freeCorpus(Corpus *corpus) {
+    free(corpus->seen);
+    free(corpus->lexemes);
+    free(corpus->lexeme_hashes);
+    free(corpus->offsets);
+    free(corpus->text);
+    free(corpus->workers);
+    freeCorpusShard(&corpus->shard);
+    pthread_cond_destroy(&corpus->turn);
+    pthread_cond_destroy(&corpus->not_full);
+    pthread_cond_destroy(&corpus->not_empty);
+    pthread_mutex_destroy(&corpus->lock);
+}
+
+void initCorpusWorker(CorpusWorker *worker) {
+    memset(worker, 0, sizeof(CorpusWorker));
+    initTokenSequence(&worker->sequence);
+}
+
+void freeCorpusWorker(CorpusWorker *worker) {
+    freeTokenSequence(&worker->sequence);
+    free(worker->types);
+    free(worker->ids);
+    free(worker->misses);
+    initCorpusWorker(worker);
+}
+
+void initCorpusShard(CorpusShard *shard) {
+    memset(shard, 0, sizeof(CorpusShard));
+}
+
+void freeCorpusShard(CorpusShard *shard) {
+    free(shard->types);
+    free(shard->ids);
+    free(shard->starts);
+    free(shard->names_offsets);
+    free(shard->names);
+    initCorpusShard(shard);
+}
+
+/* record the hash of a token sequence, returning false if it was seen
+ * before. the corpus lock must be held. */
+static bool markSeen(Corpus *corpus, uint64_t hash) {
+    // the table is kept at most half full, 0 marking empty slots.
+    hash = hash ? hash : 1;
+    if (2 * (corpus->seen_count + 1) > corpus->seen_capacity) {
+        uint64_t capacity = corpus->seen_capacity < 1024
+            ? 1024 : corpus->seen_capacity * 2;
+        uint64_t *seen = calloc(capacity, sizeof(uint64_t));
+        if (!seen) {
+            fprintf(stderr, "error: not enough memory for the corpus.\n");
+            exit(74);
+        }
+        for (uint64_t i = 0; i < corpus->seen_capacity; ++i) {
+            uint64_t old = corpus->seen[i];
+            if (!old)
+                continue;
+            uint64_t slot = old & (capacity - 1);
+            while (seen[slot])
+                slot = (slot + 1) & (capacity - 1);
+            seen[slot] = old;
+        }
+        free(corpus->seen);
+        corpus->seen = seen;
+        corpus->seen_capacity = capacity;
+    }
+
+    uint64_t mask = corpus->seen_capacity - 1;
+    uint64_t slot = hash & mask;
+    while (corpus->seen[slot]) {
+        if (corpus->seen[slot] == hash)
+            return false;
+        slot = (slot + 1) & mask;
+    }
+    corpus->seen[slot] = hash;
+    ++corpus->seen_count;
+    return true;
+}
+
+static void insertLexemeSlot(uint32_t *lexemes, uint64_t capacity,
+    uint64_t hash, uint32_t id)
+{
+    uint64_t slot = hash & (capacity - 1);
+    while (lexemes[slot])
+        slot = (slot + 1) & (capacity - 1);
+    lexemes[slot] = id;
+}
+
+/* find the id of a lexeme in the vocabulary, adding it if missing. the
+ * corpus lock must be held. */
+static uint32_t internLexeme(Corpus *corpus, uint64_t hash, const char *text,
+    int length)
+{
+    uint64_t mask = corpus->lexemes_capacity - 1;
+    if (corpus->lexemes_capacity) {
+        for (uint64_t slot = hash & mask; corpus->lexemes[slot];
+            slot = (slot + 1) & mask)
+        {
+            uint32_t id = corpus->lexemes[slot];
+            uint64_t offset = corpus->offsets[id];
+            uint64_t end = id + 1 < corpus->count
+                ? corpus->offsets[id + 1] : corpus->text_size;
+            if (corpus->lexeme_hashes[id] == hash
+                && end - offset == (uint64_t)length
+                && !memcmp(corpus->text + offset, text, length))
+            {
+                return id;
+            }
+        }
+    }
+
+    if (2 * (uint64_t)(corpus->count + 1) > corpus->lexemes_capacity) {
+        uint64_t capacity = corpus->lexemes_capacity < 1024
+            ? 1024 : corpus->lexemes_capacity * 2;
+        uint32_t *lexemes = calloc(capacity, sizeof(uint32_t));
+        if (!lexemes) {
+            fprintf(stderr, "error: not enough memory for the corpus.\n");
+            exit(74);
+        }
+        for (uint32_t id = 1; id < corpus->count; ++id) {
+            insertLexemeSlot(lexemes, capacity, corpus->lexeme_hashes[id],
+                id);
+        }
+        free(corpus->lexemes);
+        corpus->lexemes = lexemes;
+        corpus->lexemes_capacity = capacity;
+    }
+
+    uint32_t id = corpus->count++;
+    uint64_t offsets_capacity = corpus->offsets_capacity;
+    corpus->offsets = reserveCorpus(corpus->offsets,
+        &corpus->offsets_capacity, corpus->count, sizeof(uint64_t));
+    corpus->lexeme_hashes = reserveCorpus(corpus->lexeme_hashes,
+        &offsets_capacity, corpus->count, sizeof(uint64_t));
+    corpus->text = reserveCorpus(corpus->text, &corpus->text_capacity,
+        corpus->text_size + length, 1);
+
+    corpus->offsets[id] = corpus->text_size;
+    corpus->lexeme_hashes[id] = hash;
+    memcpy(corpus->text + corpus->text_size, text, length);
+    corpus->text_size += length;
+    insertLexemeSlot(corpus->lexemes, corpus->lexemes_capacity, hash, id);
+    return id;
+}
+
+/* find the id of the lexeme of a token in the cache of a worker, 0 if it
+ * is not there. */
+static uint32_t cachedId(CorpusWorker const *worker, Token token,
+    uint64_t hash)
+{
+    CorpusCacheEntry const *entry =
+        &worker->cache[hash & (CORPUS_CACHE_SIZE - 1)];
+    if (entry->id && entry->hash == hash && entry->length == token.length
+        && !memcmp(entry->text, token.start, token.length))
+    {
+        return entry->id;
+    }
+    return 0;
+}
+
+static void cacheId(CorpusWorker *worker, Token token, uint64_t hash,
+    uint32_t id)
+{
+    if (token.length > CORPUS_CACHE_TEXT)
+        return;
+    CorpusCacheEntry *entry = &worker->cache[hash & (CORPUS_CACHE_SIZE - 1)];
+    entry->hash = hash;
+    entry->id = id;
+    entry->length = (uint8_t)token.length;
+    memcpy(entry->text, token.start, token.length);
+}
+
+/* tokenize a source into the state of a worker, resolving the lexemes found
+ * in its cache and listing the others. the corpus lock is not needed.
+ * returns false if the source has error tokens. */
+static bool prepareDocument(Corpus const *corpus, CorpusWorker *worker,
+    const char *path, const char *source)
+{
+    TokenSequence *sequence = &worker->sequence;
+    if (!tokenizeSequence(sequence, source)) {
+        fprintf(stderr, "error: not enough memory to tokenize \"%s\".\n",
+            path);
+        exit(74);
+    }
+
+    bool has_ids = corpus->flags & CORPUS_IDS;
+    uint64_t tokens_capacity = worker->tokens_capacity;
+    worker->types = reserveCorpus(worker->types, &worker->tokens_capacity,
+        sequence->count, sizeof(uint8_t));
+    if (has_ids) {
+        uint64_t misses_capacity = tokens_capacity;
+        worker->ids = reserveCorpus(worker->ids, &tokens_capacity,
+            sequence->count, sizeof(uint32_t));
+        worker->misses = reserveCorpus(worker->misses, &misses_capacity,
+            sequence->count, sizeof(int));
+    }
+
+    worker->misses_count = 0;
+    for (int i = 0; i < sequence->count; ++i) {
+        Token token = sequence->tokens[i];
+        if (token.type == TOKEN_ERROR)
+            return false;
+        worker->types[i] = (uint8_t)token.type;
+        if (!has_ids)
+            continue;
+
+        uint32_t id = 0;
+        if (token.type == TOKEN_NAME || token.type == TOKEN_NUMBER
+            || token.type == TOKEN_STRING)
+        {
+            id = cachedId(worker, token, sequence->hashes[i]);
+            if (!id)
+                worker->misses[worker->misses_count++] = i;
+        }
+        worker->ids[i] = id;
+    }
+    return true;
+}
+
+/* append the document prepared by a worker to a shard. */
+static void appendDocument(CorpusShard *shard, CorpusWorker const *worker,
+    bool has_ids, const char *path)
+{
+    int count = worker->sequence.count;
+    uint64_t first = shard->tokens;
+    uint64_t tokens_capacity = shard->tokens_capacity;
+    shard->tokens += count;
+    shard->types = reserveCorpus(shard->types, &shard->tokens_capacity,
+        shard->tokens, sizeof(uint8_t));
+    memcpy(shard->types + first, worker->types, count);
+    if (has_ids) {
+        shard->ids = reserveCorpus(shard->ids, &tokens_capacity,
+            shard->tokens, sizeof(uint32_t));
+        memcpy(shard->ids + first, worker->ids, count * sizeof(uint32_t));
+    }
+
+    uint64_t documents_capacity = shard->documents_capacity;
+    uint64_t names_capacity = documents_capacity;
+    shard->starts = reserveCorpus(shard->starts, &documents_capacity,
+        shard->documents + 1, sizeof(uint64_t));
+    shard->names_offsets = reserveCorpus(shard->names_offsets,
+        &names_capacity, shard->documents + 1, sizeof(uint64_t));
+    shard->documents_capacity = (uint32_t)documents_capacity;
+
+    size_t length = strlen(path);
+    shard->names = reserveCorpus(shard->names, &shard->names_capacity,
+        shard->names_size + length, 1);
+    shard->starts[shard->documents] = first;
+    shard->names_offsets[shard->documents] = shard->names_size;
+    memcpy(shard->names + shard->names_size, path, length);
+    shard->names_size += length;
+    ++shard->documents;
+}
+
+/* add the document prepared by a worker to the corpus, unless it is a
+ * duplicate or invalid, interning the lexemes the cache missed all at once.
+ * the corpus lock must be held. */
+static CorpusStatus commitDocument(Corpus *corpus, CorpusWorker *worker,
+    const char *path, bool is_valid)
+{
+    TokenSequence const *sequence = &worker->sequence;
+    if (!is_valid) {
+        ++corpus->invalid;
+        return CORPUS_INVALID;
+    }
+    if (!markSeen(corpus, sequence->hash)) {
+        ++corpus->duplicates;
+        return CORPUS_DUPLICATE;
+    }
+    ++corpus->documents;
+    corpus->tokens += sequence->count;
+
+    for (int i = 0; i < worker->misses_count; ++i) {
+        int index = worker->misses[i];
+        Token token = sequence->tokens[index];
+        uint64_t hash = sequence->hashes[index];
+        // a lexeme repeated in the document is missed each time, but only
+        // searched for the first.
+        uint32_t id = cachedId(worker, token, hash);
+        if (!id) {
+            id = internLexeme(corpus, hash, token.start, token.length);
+            cacheId(worker, token, hash, id);
+        }
+        worker->ids[index] = id;
+    }
+
+    appendDocument(&corpus->shard, worker, corpus->flags & CORPUS_IDS, path);
+    return CORPUS_ADDED;
+}
+
+CorpusStatus addDocument(Corpus *corpus, CorpusWorker *worker,
+    const char *path, const char *source)
+{
+    bool is_valid = prepareDocument(corpus, worker, path, source);
+    pthread_mutex_lock(&corpus->lock);
+    CorpusStatus status = commitDocument(corpus, worker, path, is_valid);
+    pthread_mutex_unlock(&corpus->lock);
+    return status;
+}
+
+static bool writePadded(const void *data, size_t size, FILE *file) {
+    static const char padding[8];
+    size_t rest = (8 - size % 8) % 8;
+    return fwrite(data, 1, size, file) == size
+        && fwrite(padding, 1, rest, file) == rest;
+}
+
+/* write the entries of a document index, followed by their total. */
+static bool writeIndex(const uint64_t *entries, uint32_t count,
+    uint64_t total, FILE *file)
+{
+    return fwrite(entries, sizeof(uint64_t), count, file) == count
+        && fwrite(&total, sizeof(uint64_t), 1, file) == 1;
+}
+
+static uint64_t paddedSize(uint64_t size) {
+    return (size + 7) & ~(uint64_t)7;
+}
+
+bool writeShard(Corpus const *corpus, CorpusShard const *shard, FILE *file) {
+    bool has_ids = corpus->flags & CORPUS_IDS;
+    uint64_t index_size = (shard->documents + 1) * sizeof(uint64_t);
+    CorpusShardHeader header = {
+        .magic = CORPUS_SHARD_MAGIC,
+        .version = CORPUS_VERSION,
+        .flags = corpus->flags,
+        .documents = shard->documents,
+        .tokens = shard->tokens,
+        .types_offset = sizeof(CorpusShardHeader)
+    };
+    uint64_t offset = header.types_offset + paddedSize(shard->tokens);
+    if (has_ids) {
+        header.ids_offset = offset;
+        offset += paddedSize(shard->tokens * sizeof(uint32_t));
+    }
+    header.documents_offset = offset;
+    header.names_offset = offset + index_size;
+    header.size = header.names_offset + index_size + shard->names_size;
+
+    return fwrite(&header, sizeof(header), 1, file) == 1
+        && writePadded(shard->types, shard->tokens, file)
+        && (!has_ids || writePadded(shard->ids,
+            shard->tokens * sizeof(uint32_t), file))
+        && writeIndex(shard->starts, shard->documents, shard->tokens, file)
+        && writeIndex(shard->names_offsets, shard->documents,
+            shard->names_size, file)
+        && fwrite(shard->names, 1, shard->names_size, file)
+            == shard->names_size;
+}
+
+bool writeVocabulary(Corpus const *corpus, FILE *file) {
+    CorpusVocabularyHeader header = {
+        .magic = CORPUS_VOCABULARY_MAGIC,
+        .version = CORPUS_VERSION,
+        .count = corpus->count
+    };
+    return fwrite(&header, sizeof(header), 1, file) == 1
+        && writeIndex(corpus->offsets, corpus->count, corpus->text_size, file)
+        && fwrite(corpus->text, 1, corpus->text_size, file)
+            == corpus->text_size;
+}
+
+/* open a file of the corpus directory for writing, returning NULL after
+ * reporting the error if it cannot be. */
+static FILE *createCorpusFile(Corpus *corpus, const char *name, char *path) {
+    sprintf(path, "%s/%s", corpus->directory, name);
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "error: could not create \"%s\": %s.\n", path,
+            strerror(errno));
+    }
+    return file;
+}
+
+/* report a failed write and close the file, or just close it. */
+static bool closeCorpusFile(FILE *file, const char *path, bool is_written) {
+    if (fclose(file) != 0)
+        is_written = false;
+    if (!is_written)
+        fprintf(stderr, "error: could not write \"%s\".\n", path);
+    return is_written;
+}
+
+/* write a shard out under a shard number and free it. */
+static void saveShard(Corpus *corpus, CorpusShard *shard, uint32_t number) {
+    char name[32];
+    sprintf(name, "shard-%05u.bin", (unsigned)number);
+    char *path = malloc(strlen(corpus->directory) + sizeof(name) + 1);
+    if (!path) {
+        fprintf(stderr, "error: not enough memory for the corpus.\n");
+        exit(74);
+    }
+
+    FILE *file = createCorpusFile(corpus, name, path);
+    bool is_written = file
+        && closeCorpusFile(file, path, writeShard(corpus, shard, file));
+    if (!is_written) {
+        pthread_mutex_lock(&corpus->lock);
+        corpus->has_errors = true;
+        pthread_mutex_unlock(&corpus->lock);
+    }
+    free(path);
+    freeCorpusShard(shard);
+}
+
+/* take the next document, returning false once the export is done. */
+static bool popDocument(Corpus *corpus, CorpusDocument *document) {
+    pthread_mutex_lock(&corpus->lock);
+    while (corpus->queued == 0 && !corpus->is_done)
+        pthread_cond_wait(&corpus->not_empty, &corpus->lock);
+    bool found = corpus->queued > 0;
+    if (found) {
+        *document = corpus->queue[corpus->first];
+        corpus->first = (corpus->first + 1) % CORPUS_QUEUE_SIZE;
+        --corpus->queued;
+        pthread_cond_signal(&corpus->not_full);
+    }
+    pthread_mutex_unlock(&corpus->lock);
+    return found;
+}
+
+/* take the shard being filled if it is full, with the number it is to be
+ * written under, leaving an empty one in its place. the corpus lock must be
+ * held. */
+static bool takeFullShard(Corpus *corpus, CorpusShard *shard,
+    uint32_t *number)
+{
+    if (corpus->shard.tokens < corpus->shard_tokens)
+        return false;
+    *shard = corpus->shard;
+    *number = corpus->shards++;
+    initCorpusShard(&corpus->shard);
+    return true;
+}
+
+static void *exportWorker(void *data) {
+    Corpus *corpus = data;
+    CorpusWorker *worker = malloc(sizeof(CorpusWorker));
+    if (!worker) {
+        fprintf(stderr, "error: not enough memory for the corpus.\n");
+        exit(74);
+    }
+    initCorpusWorker(worker);
+
+    CorpusDocument document;
+    while (popDocument(corpus, &document)) {
+        bool is_valid = prepareDocument(corpus, worker, document.path,
+            document.source);
+
+        // documents are committed in the order they were queued, so that
+        // which duplicate is kept, the ids and the shards do not depend on
+        // which worker is the fastest.
+        pthread_mutex_lock(&corpus->lock);
+        while (corpus->committed != document.number)
+            pthread_cond_wait(&corpus->turn, &corpus->lock);
+        commitDocument(corpus, worker, document.path, is_valid);
+        ++corpus->committed;
+        pthread_cond_broadcast(&corpus->turn);
+        CorpusShard shard;
+        uint32_t number = 0;
+        bool is_full = takeFullShard(corpus, &shard, &number);
+        pthread_mutex_unlock(&corpus->lock);
+
+        free(document.path);
+        free(document.source);
+        if (is_full)
+            saveShard(corpus, &shard, number);
+    }
+
+    freeCorpusWorker(worker);
+    free(worker);
+    return NULL;
+}
+
+void startExport(Corpus *corpus, int threads) {
+    if (mkdir(corpus->directory, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "error: could not create \"%s\": %s.\n",
+            corpus->directory, strerror(errno));
+        exit(74);
+    }
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    corpus->workers = malloc(threads * sizeof(pthread_t));
+    if (!corpus->workers) {
+        fprintf(stderr, "error: not enough memory for the corpus.\n");
+        exit(74);
+    }
+    for (int i = 0; i < threads; ++i) {
+        if (pthread_create(&corpus->workers[i], NULL, exportWorker, corpus)) {
+            fprintf(stderr, "error: could not start exporting threads.\n");
+            exit(74);
+        }
+        corpus->threads = i + 1;
+    }
+}
+
+void exportDocument(const char *path, const char *source, void *data) {
+    Corpus *corpus = data;
+    size_t path_size = strlen(path) + 1;
+    size_t source_size = strlen(source) + 1;
+    CorpusDocument document = {malloc(path_size), malloc(source_size), 0};
+    if (!document.path || !document.source) {
+        fprintf(stderr, "error: not enough memory to export \"%s\".\n", path);
+        exit(74);
+    }
+    memcpy(document.path, path, path_size);
+    memcpy(document.source, source, source_size);
+
+    pthread_mutex_lock(&corpus->lock);
+    while (corpus->queued == CORPUS_QUEUE_SIZE)
+        pthread_cond_wait(&corpus->not_full, &corpus->lock);
+    int last = (corpus->first + corpus->queued) % CORPUS_QUEUE_SIZE;
+    document.number = corpus->numbered++;
+    corpus->queue[last] = document;
+    ++corpus->queued;
+    pthread_cond_signal(&corpus->not_empty);
+    pthread_mutex_unlock(&corpus->lock);
+}
+
+bool finishExport(Corpus *corpus) {
+    pthread_mutex_lock(&corpus->lock);
+    corpus->is_done = true;
+    pthread_cond_broadcast(&corpus->not_empty);
+    pthread_mutex_unlock(&corpus->lock);
+    for (int i = 0; i < corpus->threads; ++i)
+        pthread_join(corpus->workers[i], NULL);
+    if (corpus->shard.documents > 0)
+        saveShard(corpus, &corpus->shard, corpus->shards++);
+
+    char *path = malloc(strlen(corpus->directory) + 32);
+    if (!path) {
+        fprintf(stderr, "error: not enough memory for the corpus.\n");
+        exit(74);
+    }
+
+    FILE *file = createCorpusFile(corpus, "types.txt", path);
+    bool is_written = file != NULL;
+    if (file) {
+        bool is_listed = true;
+        for (int type = 0; type < TOKEN_COUNT && is_listed; ++type)
+            is_listed = fprintf(file, "%s\n", Token_Names[type]) > 0;
+        is_written = closeCorpusFile(file, path, is_listed);
+    }
+
+    if (corpus->flags & CORPUS_IDS) {
+        file = createCorpusFile(corpus, "vocabulary.bin", path);
+        is_written = file
+            && closeCorpusFile(file, path, writeVocabulary(corpus, file))
+            && is_written;
+    }
+
+    free(path);
+    return is_written && !corpus->has_errors;
+}
@@ -0,0 +1,291 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "diff.h"
+
+/* layout of an exported corpus.
+ *
+ * a corpus is a directory of shards, `shard-00000.bin` and on, each meant to
+ * be mapped in memory and read as is, for instance with numpy.memmap(). a
+ * shard starts with a CorpusShardHeader, followed by these arrays at the
+ * offsets given in the header, each aligned on 8 bytes:
+ *  - types: the type of each token, one uint8_t per token, the ids of
+ *      pytokTokenName(). `types.txt` lists their names, one per line.
+ *  - ids: with CORPUS_IDS, the id of the lexeme of each NAME, NUMBER and
+ *      STRING token as an uint32_t, 0 for other tokens. ids are shared by all
+ *      shards and `vocabulary.bin` maps them back to lexemes.
+ *  - documents: documents + 1 uint64_t, the index of the first token of each
+ *      document, then the number of tokens. each document ends with its
+ *      ENDMARKER.
+ *  - names: documents + 1 uint64_t, the offset of the path of each document
+ *      in the text that follows, then the size of that text.
+ *
+ * `vocabulary.bin` is a CorpusVocabularyHeader followed by count + 1
+ * uint64_t, the offset of the lexeme of each id in the text that follows and
+ * then its size. id 0 is the empty lexeme of tokens without one.
+ *
+ * documents are laid out in the order they were queued, whatever thread
+ * tokenized them, and ids are given in the order lexemes first appear, so
+ * exporting the same files again gives the same corpus byte for byte.
+ *
+ * integers are in the byte order of the machine that exported the corpus.
+ */
+
+#define CORPUS_VERSION 1
+#define CORPUS_SHARD_MAGIC "PTCS"
+#define CORPUS_VOCABULARY_MAGIC "PTCV"
+#define CORPUS_SHARD_TOKENS (1 << 24)
+#define CORPUS_QUEUE_SIZE 64
+#define CORPUS_CACHE_SIZE 4096
+#define CORPUS_CACHE_TEXT 27
+
+typedef enum {
+    CORPUS_IDS = 1
+} CorpusFlags;
+
+/* CorpusShardHeader: the start of a shard.
+ *
+ * @magic: CORPUS_SHARD_MAGIC.
+ * @version: CORPUS_VERSION.
+ * @flags: CorpusFlags of the corpus.
+ * @documents: number of documents.
+ * @tokens: number of tokens.
+ * @types_offset, @ids_offset, @documents_offset, @names_offset: offsets of
+ *      the arrays in the shard, ids_offset being 0 without CORPUS_IDS.
+ * @size: size of the shard.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t documents;
+    uint64_t tokens;
+    uint64_t types_offset;
+    uint64_t ids_offset;
+    uint64_t documents_offset;
+    uint64_t names_offset;
+    uint64_t size;
+} CorpusShardHeader;
+
+/* CorpusVocabularyHeader: the start of the vocabulary.
+ *
+ * @magic: CORPUS_VOCABULARY_MAGIC.
+ * @version: CORPUS_VERSION.
+ * @count: number of ids, 0 included.
+ * @reserved: 0.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+} CorpusVocabularyHeader;
+
+/* CorpusDocument: a source waiting in the queue to be exported.
+ *
+ * @path: path of the source.
+ * @source: the source, NUL terminated.
+ * @number: position of the source in the queue since the export started.
+ */
+typedef struct {
+    char *path;
+    char *source;
+    uint64_t number;
+} CorpusDocument;
+
+/* CorpusCacheEntry: a lexeme id recently looked up by a worker.
+ *
+ * @hash: hash of the token.
+ * @id: id of the lexeme, 0 if the entry is empty.
+ * @length: length of the lexeme.
+ * @text: the lexeme, for those of at most CORPUS_CACHE_TEXT bytes.
+ */
+typedef struct {
+    uint64_t hash;
+    uint32_t id;
+    uint8_t length;
+    char text[CORPUS_CACHE_TEXT];
+} CorpusCacheEntry;
+
+/* CorpusWorker: the state a worker keeps from one document to the next.
+ *
+ * @sequence: tokens of the document being added.
+ * @types, @ids, @misses, @tokens_capacity: type and lexeme id of each token
+ *      of the document, and the indexes of the tokens whose lexeme was not
+ *      in the cache, their id being left 0 until the document is committed.
+ * @misses_count: number of those tokens.
+ * @cache: ids of lexemes looked up before, direct-mapped by hash, so that
+ *      the vocabulary is only searched, under the corpus lock, for the
+ *      lexemes new to the worker.
+ */
+typedef struct {
+    TokenSequence sequence;
+    uint8_t *types;
+    uint32_t *ids;
+    int *misses;
+    uint64_t tokens_capacity;
+    int misses_count;
+    CorpusCacheEntry cache[CORPUS_CACHE_SIZE];
+} CorpusWorker;
+
+/* CorpusShard: a shard being filled.
+ *
+ * @tokens, @tokens_capacity: number of tokens and room for them.
+ * @types, @ids: the arrays of the shard.
+ * @documents, @documents_capacity: number of documents and room for them.
+ * @starts: first token of each document.
+ * @names_offsets: offset of the path of each document in names.
+ * @names, @names_size, @names_capacity: paths of the documents.
+ */
+typedef struct {
+    uint64_t tokens;
+    uint64_t tokens_capacity;
+    uint8_t *types;
+    uint32_t *ids;
+    uint32_t documents;
+    uint32_t documents_capacity;
+    uint64_t *starts;
+    uint64_t *names_offsets;
+    char *names;
+    uint64_t names_size;
+    uint64_t names_capacity;
+} CorpusShard;
+
+typedef enum {
+    CORPUS_ADDED,
+    CORPUS_DUPLICATE,
+    CORPUS_INVALID
+} CorpusStatus;
+
+/* Corpus: an export in progress, shared by its workers.
+ *
+ * @directory: where shards are written.
+ * @flags: CorpusFlags.
+ * @shard_tokens: number of tokens from which a shard is written out.
+ * @lock: guards everything below.
+ * @seen, @seen_count, @seen_capacity: hashes of the token sequences of the
+ *      documents exported, to skip the sources differing only in layout
+ *      and comments from one exported before.
+ * @lexemes, @lexemes_capacity: open addressing table of the ids of the
+ *      vocabulary, 0 for empty slots.
+ * @lexeme_hashes: hash of each id.
+ * @offsets, @count, @offsets_capacity: offset of each lexeme in text, and
+ *      number of ids.
+ * @text, @text_size, @text_capacity: the lexemes of the vocabulary.
+ * @shard: the shard being filled.
+ * @shards: number of shards written out.
+ * @documents, @tokens, @duplicates, @invalid: number of documents and tokens
+ *      exported, and of sources skipped as duplicates or for holding error
+ *      tokens.
+ * @has_errors: true once a file could not be written.
+ * @queue, @first, @queued: ring of the documents waiting for a worker.
+ * @numbered: number of documents queued, the next one's number.
+ * @committed: number of queued documents added or left out. a worker
+ *      commits its document once all those before it are, waiting on turn.
+ * @is_done: true once no more documents will be queued.
+ * @threads, @workers: number of worker threads and their handles.
+ */
+typedef struct {
+    const char *directory;
+    uint32_t flags;
+    uint64_t shard_tokens;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_cond_t turn;
+    uint64_t *seen;
+    uint64_t seen_count;
+    uint64_t seen_capacity;
+    uint32_t *lexemes;
+    uint64_t lexemes_capacity;
+    uint64_t *lexeme_hashes;
+    uint64_t *offsets;
+    uint32_t count;
+    uint64_t offsets_capacity;
+    char *text;
+    uint64_t text_size;
+    uint64_t text_capacity;
+    CorpusShard shard;
+    uint32_t shards;
+    uint64_t documents;
+    uint64_t tokens;
+    uint64_t duplicates;
+    uint64_t invalid;
+    bool has_errors;
+    CorpusDocument queue[CORPUS_QUEUE_SIZE];
+    int first;
+    int queued;
+    uint64_t numbered;
+    uint64_t committed;
+    bool is_done;
+    int threads;
+    pthread_t *workers;
+} Corpus;
+
+/* initCorpus: initialize an export.
+ *
+ * @directory: where the corpus is written, created by startExport() if
+ *      missing.
+ * @flags: CorpusFlags.
+ * @shard_tokens: target number of tokens of a shard. documents are not
+ *      split, a shard is written out once it has that many tokens.
+ */
+void initCorpus(Corpus *corpus, const char *directory, uint32_t flags,
+    uint64_t shard_tokens);
+
+/* freeCorpus: free the memory held by an export. */
+void freeCorpus(Corpus *corpus);
+
+/* initCorpusWorker: initialize the state of a worker. */
+void initCorpusWorker(CorpusWorker *worker);
+
+/* freeCorpusWorker: free the memory held by the state of a worker. */
+void freeCorpusWorker(CorpusWorker *worker);
+
+/* initCorpusShard: initialize an empty shard. */
+void initCorpusShard(CorpusShard *shard);
+
+/* freeCorpusShard: free the memory held by a shard. */
+void freeCorpusShard(CorpusShard *shard);
+
+/* addDocument: tokenize a source with the state of a worker and add it to
+ * the shard of the corpus being filled.
+ *
+ * sources with error tokens, or with the same tokens as one added before,
+ * are left out.
+ */
+CorpusStatus addDocument(Corpus *corpus, CorpusWorker *worker,
+    const char *path, const char *source);
+
+/* writeShard: write a shard to a file, returning false on write errors. */
+bool writeShard(Corpus const *corpus, CorpusShard const *shard, FILE *file);
+
+/* writeVocabulary: write the vocabulary to a file, returning false on write
+ * errors.
+ */
+bool writeVocabulary(Corpus const *corpus, FILE *file);
+
+/* startExport: start the threads exporting the documents queued.
+ *
+ * @threads: number of worker threads, or 0 for one per processor.
+ */
+void startExport(Corpus *corpus, int threads);
+
+/* exportDocument: queue a source to export, waiting while the queue is
+ * full. a VisitFunc taking the corpus as data, for walkTree().
+ */
+void exportDocument(const char *path, const char *source, void *data);
+
+/* finishExport: wait for the queued documents to be exported, then write
+ * the last shard, the vocabulary and the type names.
+ *
+ * returns false if any file could not be written.
+ */
+bool finishExport(Corpus *corpus);
+
+#endif
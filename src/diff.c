@@ -0,0 +1,513 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "diff.h"
+
+/* search rounds after which a split settles for the furthest reaching
+ * paths. GNU diff scales this with the square root of the input, but once
+ * unmatched tokens are left out and anchors split the input, the gaps left
+ * are mostly unrelated code, where more rounds cost time and find little. */
+#define DIFF_TOO_EXPENSIVE 256
+
+/* DiffContext: the sequences being compared and the search state.
+ *
+ * @old_hashes, @new_hashes: the token hashes of both sequences.
+ * @old_changed, @new_changed: where the tokens found to differ are marked.
+ * @forward, @backward: furthest x reached on each diagonal x - y, indexed
+ *      from the lowest diagonal.
+ * @too_expensive: number of search rounds after which the search settles
+ *      for a good enough split.
+ */
+typedef struct {
+    const uint64_t *old_hashes;
+    const uint64_t *new_hashes;
+    bool *old_changed;
+    bool *new_changed;
+    int *forward;
+    int *backward;
+    int too_expensive;
+} DiffContext;
+
+static uint64_t mixBits(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+static uint64_t tokenKey(Token const *token) {
+    uint64_t hash = (0xcbf29ce484222325ULL ^ (uint64_t)token->type)
+        * 0x100000001b3ULL;
+    switch (token->type) {
+        case TOKEN_NEWLINE:
+        case TOKEN_INDENT:
+        case TOKEN_DEDENT:
+            break;
+        default:
+            for (int i = 0; i < token->length; ++i) {
+                hash ^= (unsigned char)token->start[i];
+                hash *= 0x100000001b3ULL;
+            }
+            break;
+    }
+    return mixBits(hash);
+}
+
+void initTokenSequence(TokenSequence *sequence) {
+    sequence->count = 0;
+    sequence->capacity = 0;
+    sequence->tokens = NULL;
+    sequence->hashes = NULL;
+    sequence->hash = 0;
+}
+
+void freeTokenSequence(TokenSequence *sequence) {
+    free(sequence->tokens);
+    free(sequence->hashes);
+    initTokenSequence(sequence);
+}
+
+static bool growSequence(TokenSequence *sequence) {
+    int capacity = sequence->capacity < 256 ? 256 : sequence->capacity * 2;
+    Token *tokens = realloc(sequence->tokens, capacity * sizeof(Token));
+    if (!tokens)
+        return false;
+    sequence->tokens = tokens;
+
+    uint64_t *hashes = realloc(sequence->hashes, capacity * sizeof(uint64_t));
+    if (!hashes)
+        return false;
+    sequence->hashes = hashes;
+    sequence->capacity = capacity;
+    return true;
+}
+
+bool tokenizeSequence(TokenSequence *sequence, const char *source) {
+    Scanner scanner;
+    initScanner(&scanner, source);
+    sequence->count = 0;
+    sequence->hash = 0;
+
+    for (;;) {
+        if (sequence->count == sequence->capacity && !growSequence(sequence))
+            return false;
+
+        Token token = scanToken(&scanner);
+        uint64_t hash = tokenKey(&token);
+        sequence->tokens[sequence->count] = token;
+        sequence->hashes[sequence->count++] = hash;
+        sequence->hash = mixBits(sequence->hash ^ hash);
+        if (token.type == TOKEN_ENDMARKER)
+            return true;
+    }
+}
+
+void initTokenDiff(TokenDiff *diff) {
+    diff->count = 0;
+    diff->capacity = 0;
+    diff->edits = NULL;
+    diff->changed_capacity = 0;
+    diff->old_changed = NULL;
+    diff->new_changed = NULL;
+    diff->kept = NULL;
+    diff->kept_hashes = NULL;
+    diff->kept_changed = NULL;
+    diff->anchors = NULL;
+    diff->diagonals = NULL;
+    diff->classes = NULL;
+    diff->classes_capacity = 0;
+}
+
+void freeTokenDiff(TokenDiff *diff) {
+    free(diff->edits);
+    free(diff->old_changed);
+    free(diff->new_changed);
+    free(diff->kept);
+    free(diff->kept_hashes);
+    free(diff->kept_changed);
+    free(diff->anchors);
+    free(diff->diagonals);
+    free(diff->classes);
+    initTokenDiff(diff);
+}
+
+static bool reserveChanged(TokenDiff *diff, int count) {
+    if (count <= diff->changed_capacity)
+        return true;
+
+    free(diff->old_changed);
+    free(diff->new_changed);
+    free(diff->kept);
+    free(diff->kept_hashes);
+    free(diff->kept_changed);
+    free(diff->anchors);
+    free(diff->diagonals);
+    diff->old_changed = malloc(count);
+    diff->new_changed = malloc(count);
+    diff->kept = malloc(2 * (size_t)count * sizeof(int));
+    diff->kept_hashes = malloc(2 * (size_t)count * sizeof(uint64_t));
+    diff->kept_changed = malloc(2 * (size_t)count);
+    // the anchors, paired, then the piles and links of patience sorting.
+    diff->anchors = malloc(4 * (size_t)count * sizeof(int));
+    // both sides of the forward and backward diagonals, plus a sentinel at
+    // each end.
+    diff->diagonals = malloc(2 * (2 * (size_t)count + 3) * sizeof(int));
+    diff->changed_capacity = count;
+    if (!diff->old_changed || !diff->new_changed || !diff->kept
+        || !diff->kept_hashes || !diff->kept_changed || !diff->anchors
+        || !diff->diagonals)
+    {
+        freeTokenDiff(diff);
+        return false;
+    }
+    return true;
+}
+
+/* empty the table of hashes, with room for count of them. */
+static bool resetClasses(TokenDiff *diff, int count) {
+    int capacity = diff->classes_capacity;
+    while (capacity < 2 * count)
+        capacity = capacity < 1024 ? 1024 : 2 * capacity;
+    if (capacity != diff->classes_capacity) {
+        free(diff->classes);
+        diff->classes = malloc(capacity * sizeof(TokenClass));
+        diff->classes_capacity = diff->classes ? capacity : 0;
+        if (!diff->classes)
+            return false;
+    }
+    memset(diff->classes, 0, capacity * sizeof(TokenClass));
+    return true;
+}
+
+/* find the slot of a hash, empty if the hash is not in the table. */
+static TokenClass *findClass(TokenDiff const *diff, uint64_t hash) {
+    int mask = diff->classes_capacity - 1;
+    int slot = (int)(hash & mask);
+    for (;;) {
+        TokenClass *class = &diff->classes[slot];
+        if (class->hash == hash || (!class->old_count && !class->new_count))
+            return class;
+        slot = (slot + 1) & mask;
+    }
+}
+
+/* keep the tokens of a range with a match in the other sequence, returning
+ * how many. */
+static int keepTokens(TokenDiff *diff, const uint64_t *hashes, int start,
+    int end, bool is_old, int *kept, uint64_t *kept_hashes)
+{
+    int count = 0;
+    for (int i = start; i < end; ++i) {
+        TokenClass *class = findClass(diff, hashes[i]);
+        if (!(is_old ? class->new_count : class->old_count))
+            continue;
+        if (!is_old)
+            class->new_index = count;
+        kept[count] = i;
+        kept_hashes[count++] = hashes[i];
+    }
+    return count;
+}
+
+/* find the longest run of tokens found once in each sequence that are in
+ * the same order in both, by patience sorting. returns the number of
+ * anchors, each an old and a new index at the start of anchors. */
+static int findAnchors(TokenDiff *diff, const uint64_t *old_hashes,
+    int old_count)
+{
+    int *pairs = diff->anchors;
+    int *piles = pairs + 2 * diff->changed_capacity;
+    int *links = piles + diff->changed_capacity;
+    int count = 0, piles_count = 0;
+    for (int x = 0; x < old_count; ++x) {
+        TokenClass const *class = findClass(diff, old_hashes[x]);
+        if (class->old_count != 1 || class->new_count != 1)
+            continue;
+
+        // the leftmost pile whose top is after the token in the new
+        // sequence.
+        int y = class->new_index;
+        int low = 0, high = piles_count;
+        while (low < high) {
+            int mid = low + (high - low) / 2;
+            if (pairs[2 * piles[mid] + 1] < y)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        links[count] = low > 0 ? piles[low - 1] : -1;
+        piles[low] = count;
+        if (low == piles_count)
+            ++piles_count;
+        pairs[2 * count] = x;
+        pairs[2 * count + 1] = y;
+        ++count;
+    }
+
+    // follow the links back from the last pile, then move the anchors of
+    // the run to the start.
+    int *run = piles;
+    for (int i = piles_count - 1, k = piles_count ? piles[i] : -1; i >= 0;
+        --i, k = links[k])
+    {
+        run[i] = k;
+    }
+    for (int i = 0; i < piles_count; ++i) {
+        int k = run[i];
+        pairs[2 * i] = pairs[2 * k];
+        pairs[2 * i + 1] = pairs[2 * k + 1];
+    }
+    return piles_count;
+}
+
+static bool addEdit(TokenDiff *diff, TokenEdit edit) {
+    if (diff->count == diff->capacity) {
+        int capacity = diff->capacity < 8 ? 8 : diff->capacity * 2;
+        TokenEdit *edits = realloc(diff->edits, capacity * sizeof(TokenEdit));
+        if (!edits)
+            return false;
+        diff->edits = edits;
+        diff->capacity = capacity;
+    }
+
+    diff->edits[diff->count++] = edit;
+    return true;
+}
+
+/* find the middle of an edit path between old[xoff, xlim) and
+ * new[yoff, ylim), searching from both ends at once until the paths
+ * overlap, or settle for the furthest reaching split once the search is
+ * too expensive. */
+static void findSplit(DiffContext const *context, int xoff, int xlim,
+    int yoff, int ylim, int *xmid, int *ymid)
+{
+    const uint64_t *xv = context->old_hashes;
+    const uint64_t *yv = context->new_hashes;
+    int *fd = context->forward;
+    int *bd = context->backward;
+    int dmin = xoff - ylim;
+    int dmax = xlim - yoff;
+    int fmid = xoff - yoff;
+    int bmid = xlim - ylim;
+    int fmin = fmid, fmax = fmid;
+    int bmin = bmid, bmax = bmid;
+    bool odd = (fmid - bmid) & 1;
+
+    fd[fmid] = xoff;
+    bd[bmid] = xlim;
+    for (int cost = 1;; ++cost) {
+        if (fmin > dmin)
+            fd[--fmin - 1] = -1;
+        else
+            ++fmin;
+        if (fmax < dmax)
+            fd[++fmax + 1] = -1;
+        else
+            --fmax;
+        for (int d = fmax; d >= fmin; d -= 2) {
+            int low = fd[d - 1], high = fd[d + 1];
+            int x = low >= high ? low + 1 : high;
+            int y = x - d;
+            while (x < xlim && y < ylim && xv[x] == yv[y])
+                ++x, ++y;
+            fd[d] = x;
+            if (odd && bmin <= d && d <= bmax && bd[d] <= x) {
+                *xmid = x;
+                *ymid = y;
+                return;
+            }
+        }
+
+        if (bmin > dmin)
+            bd[--bmin - 1] = INT_MAX;
+        else
+            ++bmin;
+        if (bmax < dmax)
+            bd[++bmax + 1] = INT_MAX;
+        else
+            --bmax;
+        for (int d = bmax; d >= bmin; d -= 2) {
+            int low = bd[d - 1], high = bd[d + 1];
+            int x = low < high ? low : high - 1;
+            int y = x - d;
+            while (x > xoff && y > yoff && xv[x - 1] == yv[y - 1])
+                --x, --y;
+            bd[d] = x;
+            if (!odd && fmin <= d && d <= fmax && x <= fd[d]) {
+                *xmid = x;
+                *ymid = y;
+                return;
+            }
+        }
+
+        if (cost < context->too_expensive)
+            continue;
+
+        // split at whichever of the forward and backward paths got the
+        // furthest.
+        int fxybest = -1, fxbest = xoff;
+        for (int d = fmax; d >= fmin; d -= 2) {
+            int x = fd[d] < xlim ? fd[d] : xlim;
+            int y = x - d;
+            if (ylim < y)
+                x = ylim + d, y = ylim;
+            if (fxybest < x + y)
+                fxybest = x + y, fxbest = x;
+        }
+        int bxybest = INT_MAX, bxbest = xlim;
+        for (int d = bmax; d >= bmin; d -= 2) {
+            int x = bd[d] > xoff ? bd[d] : xoff;
+            int y = x - d;
+            if (y < yoff)
+                x = yoff + d, y = yoff;
+            if (x + y < bxybest)
+                bxybest = x + y, bxbest = x;
+        }
+
+        if ((xlim + ylim) - bxybest < fxybest - (xoff + yoff)) {
+            *xmid = fxbest;
+            *ymid = fxybest - fxbest;
+        } else {
+            *xmid = bxbest;
+            *ymid = bxybest - bxbest;
+        }
+        return;
+    }
+}
+
+/* mark the tokens of old[xoff, xlim) and new[yoff, ylim) that are not part
+ * of the common subsequence found. */
+static void compareRanges(DiffContext const *context, int xoff, int xlim,
+    int yoff, int ylim)
+{
+    const uint64_t *xv = context->old_hashes;
+    const uint64_t *yv = context->new_hashes;
+    while (xoff < xlim && yoff < ylim && xv[xoff] == yv[yoff])
+        ++xoff, ++yoff;
+    while (xoff < xlim && yoff < ylim && xv[xlim - 1] == yv[ylim - 1])
+        --xlim, --ylim;
+
+    if (xoff == xlim) {
+        memset(context->new_changed + yoff, true, ylim - yoff);
+    } else if (yoff == ylim) {
+        memset(context->old_changed + xoff, true, xlim - xoff);
+    } else {
+        int xmid, ymid;
+        findSplit(context, xoff, xlim, yoff, ylim, &xmid, &ymid);
+        compareRanges(context, xoff, xmid, yoff, ymid);
+        compareRanges(context, xmid, xlim, ymid, ylim);
+    }
+}
+
+int diffTokens(TokenDiff *diff, TokenSequence const *old_tokens,
+    TokenSequence const *new_tokens)
+{
+    int old_count = old_tokens->count;
+    int new_count = new_tokens->count;
+    diff->count = 0;
+    if (old_count == new_count && old_tokens->hash == new_tokens->hash
+        && !memcmp(old_tokens->hashes, new_tokens->hashes,
+            old_count * sizeof(uint64_t)))
+    {
+        return 0;
+    }
+
+    int count = old_count > new_count ? old_count : new_count;
+    if (!reserveChanged(diff, count))
+        return -1;
+
+    // the common start and end are left out of the search.
+    const uint64_t *old_hashes = old_tokens->hashes;
+    const uint64_t *new_hashes = new_tokens->hashes;
+    int start = 0, old_end = old_count, new_end = new_count;
+    while (start < old_end && start < new_end
+        && old_hashes[start] == new_hashes[start])
+    {
+        ++start;
+    }
+    while (old_end > start && new_end > start
+        && old_hashes[old_end - 1] == new_hashes[new_end - 1])
+    {
+        --old_end, --new_end;
+    }
+    memset(diff->old_changed, false, old_count);
+    memset(diff->new_changed, false, new_count);
+    memset(diff->old_changed + start, true, old_end - start);
+    memset(diff->new_changed + start, true, new_end - start);
+
+    if (!resetClasses(diff, old_end + new_end - 2 * start))
+        return -1;
+    for (int i = start; i < old_end; ++i) {
+        TokenClass *class = findClass(diff, old_hashes[i]);
+        class->hash = old_hashes[i];
+        ++class->old_count;
+    }
+    for (int i = start; i < new_end; ++i) {
+        TokenClass *class = findClass(diff, new_hashes[i]);
+        class->hash = new_hashes[i];
+        ++class->new_count;
+    }
+
+    // tokens with no match in the other sequence are changed whatever the
+    // rest, so only the others are searched.
+    int *old_kept = diff->kept;
+    int *new_kept = diff->kept + count;
+    uint64_t *old_kept_hashes = diff->kept_hashes;
+    uint64_t *new_kept_hashes = diff->kept_hashes + count;
+    int old_kept_count = keepTokens(diff, old_hashes, start, old_end, true,
+        old_kept, old_kept_hashes);
+    int new_kept_count = keepTokens(diff, new_hashes, start, new_end, false,
+        new_kept, new_kept_hashes);
+    int anchors = findAnchors(diff, old_kept_hashes, old_kept_count);
+
+    DiffContext context = {
+        .old_hashes = old_kept_hashes,
+        .new_hashes = new_kept_hashes,
+        .old_changed = diff->kept_changed,
+        .new_changed = diff->kept_changed + count,
+        .forward = diff->diagonals + new_kept_count + 1,
+        .backward = diff->diagonals + 2 * count + 3 + new_kept_count + 1,
+        .too_expensive = DIFF_TOO_EXPENSIVE
+    };
+    memset(diff->kept_changed, false, 2 * (size_t)count);
+
+    // anchors are unchanged, and split the search.
+    int x = 0, y = 0;
+    for (int i = 0; i < anchors; ++i) {
+        int anchor_x = diff->anchors[2 * i];
+        int anchor_y = diff->anchors[2 * i + 1];
+        compareRanges(&context, x, anchor_x, y, anchor_y);
+        x = anchor_x + 1;
+        y = anchor_y + 1;
+    }
+    compareRanges(&context, x, old_kept_count, y, new_kept_count);
+
+    for (int i = 0; i < old_kept_count; ++i)
+        diff->old_changed[old_kept[i]] = context.old_changed[i];
+    for (int i = 0; i < new_kept_count; ++i)
+        diff->new_changed[new_kept[i]] = context.new_changed[i];
+
+    // tokens left unchanged pair up in order, edits are what lies between.
+    int i = 0, j = 0;
+    while (i < old_count || j < new_count) {
+        if (i < old_count && j < new_count && !diff->old_changed[i]
+            && !diff->new_changed[j])
+        {
+            ++i, ++j;
+            continue;
+        }
+
+        TokenEdit edit = {.old_start = i, .new_start = j};
+        while (i < old_count && diff->old_changed[i])
+            ++i;
+        while (j < new_count && diff->new_changed[j])
+            ++j;
+        edit.old_count = i - edit.old_start;
+        edit.new_count = j - edit.new_start;
+        if (!addEdit(diff, edit))
+            return -1;
+    }
+    return diff->count;
+}
@@ -0,0 +1,129 @@
+#ifndef DIFF_H
+#define DIFF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "scanner.h"
+
+/* TokenSequence: the tokens of a source, each with a hash of its type and
+ * lexeme.
+ *
+ * the lexemes of NEWLINE, INDENT and DEDENT tokens are left out of their
+ * hashes, so sources that only differ in whitespace, comments, line breaks
+ * within brackets or the width of indents have the same hashes.
+ *
+ * @count: number of tokens, the end marker included.
+ * @capacity: number of tokens that fit before growing.
+ * @tokens: the tokens.
+ * @hashes: hash of each token.
+ * @hash: hash of the whole sequence.
+ */
+typedef struct {
+    int count;
+    int capacity;
+    Token *tokens;
+    uint64_t *hashes;
+    uint64_t hash;
+} TokenSequence;
+
+/* TokenEdit: a run of tokens of the old source replaced by a run of tokens
+ * of the new one, either run possibly empty.
+ *
+ * @old_start, @old_count: index and number of the tokens removed.
+ * @new_start, @new_count: index and number of the tokens inserted.
+ */
+typedef struct {
+    int old_start;
+    int old_count;
+    int new_start;
+    int new_count;
+} TokenEdit;
+
+/* TokenClass: the tokens of both sequences sharing a hash.
+ *
+ * @hash: the hash.
+ * @old_count, @new_count: number of tokens with the hash in each sequence,
+ *      both 0 for an empty slot.
+ * @new_index: index among the tokens kept of the last new token with the
+ *      hash.
+ */
+typedef struct {
+    uint64_t hash;
+    int old_count;
+    int new_count;
+    int new_index;
+} TokenClass;
+
+/* TokenDiff: the edits turning a token sequence into another, and the
+ * memory used to find them, kept across diffs.
+ *
+ * @count: number of edits.
+ * @capacity: number of edits that fit before growing.
+ * @edits: the edits, in source order.
+ * @changed_capacity: number of tokens the arrays below can hold.
+ * @old_changed, @new_changed: whether each token is removed or inserted.
+ * @kept: index of each token kept for the search, those of the old
+ *      sequence then those of the new one.
+ * @kept_hashes: hash of each token kept.
+ * @kept_changed: whether each token kept is removed or inserted.
+ * @anchors: the tokens found once in each sequence, and the longest run of
+ *      them in the same order in both.
+ * @diagonals: the furthest points reached on each diagonal, forward and
+ *      backward.
+ * @classes, @classes_capacity: open addressing table of the hashes of the
+ *      tokens compared.
+ */
+typedef struct {
+    int count;
+    int capacity;
+    TokenEdit *edits;
+    int changed_capacity;
+    bool *old_changed;
+    bool *new_changed;
+    int *kept;
+    uint64_t *kept_hashes;
+    bool *kept_changed;
+    int *anchors;
+    int *diagonals;
+    TokenClass *classes;
+    int classes_capacity;
+} TokenDiff;
+
+/* initTokenSequence: initialize an empty sequence. */
+void initTokenSequence(TokenSequence *sequence);
+
+/* freeTokenSequence: free the memory held by a sequence. */
+void freeTokenSequence(TokenSequence *sequence);
+
+/* tokenizeSequence: replace the tokens of a sequence by those of a source.
+ *
+ * the tokens point into the source, which must outlive the sequence.
+ * returns false if out of memory.
+ */
+bool tokenizeSequence(TokenSequence *sequence, const char *source);
+
+/* initTokenDiff: initialize a diff with no edits. */
+void initTokenDiff(TokenDiff *diff);
+
+/* freeTokenDiff: free the memory held by a diff. */
+void freeTokenDiff(TokenDiff *diff);
+
+/* diffTokens: find the edits turning a sequence into another.
+ *
+ * sequences with the same hashes are told apart at once. otherwise the
+ * common start and end are trimmed, tokens with no match in the other
+ * sequence are left out as in GNU diff, and the tokens found once in each
+ * sequence anchor the rest, as in patience diff. what lies between anchors
+ * is compared with Myers' algorithm, in linear space. the edits may not be
+ * the fewest possible: anchors are taken as they are, and as in GNU diff
+ * the search settles for a good enough split when the tokens between two
+ * anchors have very little in common, which bounds the time taken.
+ *
+ * returns the number of edits, 0 if the sequences are the same, or -1 if
+ * out of memory.
+ */
+int diffTokens(TokenDiff *diff, TokenSequence const *old_tokens,
+    TokenSequence const *new_tokens);
+
+#endif
@@ -0,0 +1,72 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "filter.h"
+
+void initFilterScanner(FilterScanner *fscnr, const char *source) {
+    initScanner(&fscnr->scanner, source);
+    memset(&fscnr->statements, 0, sizeof(fscnr->statements));
+    memset(&fscnr->tokens, 0, sizeof(fscnr->tokens));
+    fscnr->is_statement_start = true;
+}
+
+Token scanFiltered(FilterScanner *fscnr) {
+    Scanner *scnr = &fscnr->scanner;
+
+    // indentation is only tracked if it was asked for, otherwise line starts
+    // are skipped over along with the newlines of skipped statements.
+    bool track_indents = tokenSetHas(&fscnr->tokens, TOKEN_INDENT)
+        || tokenSetHas(&fscnr->tokens, TOKEN_DEDENT);
+
+    // true once a statement was skipped, its terminator is dropped as well.
+    bool skipped = false;
+
+    for (;;) {
+        if (!track_indents && scnr->is_line_start && scnr->level == 0) {
+            skipBlankLines(scnr);
+            fscnr->is_statement_start = true;
+        }
+
+        Token token = scanToken(scnr);
+
+        switch (token.type) {
+            case TOKEN_ERROR:
+            case TOKEN_ENDMARKER:
+                return token;
+            case TOKEN_INDENT:
+            case TOKEN_DEDENT:
+                fscnr->is_statement_start = true;
+                break;
+            case TOKEN_NEWLINE:
+            case TOKEN_SEMI:
+                if (token.type == TOKEN_NEWLINE || scnr->level == 0) {
+                    fscnr->is_statement_start = true;
+                    if (skipped) {
+                        skipped = false;
+                        continue;
+                    }
+                    break;
+                }
+                // a semicolon inside brackets is an ordinary token.
+                /* fall through */
+            default:
+                if (fscnr->is_statement_start) {
+                    fscnr->is_statement_start = false;
+                    if (!tokenSetHas(&fscnr->statements, token.type)) {
+                        skipStatement(scnr);
+                        if (!track_indents && *scnr->current == '\n') {
+                            skipBlankLines(scnr);
+                            fscnr->is_statement_start = true;
+                        } else {
+                            skipped = true;
+                        }
+                        continue;
+                    }
+                }
+                break;
+        }
+
+        if (tokenSetHas(&fscnr->tokens, token.type))
+            return token;
+    }
+}
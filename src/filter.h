@@ -0,0 +1,58 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdbool.h>
+
+#include "scanner.h"
+
+#define TOKEN_SET_SIZE ((TOKEN_COUNT + 7) / 8)
+
+/* TokenSet: a set of token types, as a bit per type. */
+typedef struct {
+    unsigned char bits[TOKEN_SET_SIZE];
+} TokenSet;
+
+static inline void tokenSetAdd(TokenSet *set, TokenType type) {
+    set->bits[type / 8] |= 1u << (type % 8);
+}
+
+static inline bool tokenSetHas(TokenSet const *set, TokenType type) {
+    return set->bits[type / 8] & (1u << (type % 8));
+}
+
+/* FilterScanner: a scanner that only produces the tokens asked for.
+ *
+ * @scanner: the underlying scanner.
+ * @statements: types of the first token of statements to tokenize. any
+ *      other statement is skipped without being tokenized.
+ * @tokens: types of the tokens to return from tokenized statements.
+ * @is_statement_start: true if the next token starts a statement.
+ */
+typedef struct {
+    Scanner scanner;
+    TokenSet statements;
+    TokenSet tokens;
+    bool is_statement_start;
+} FilterScanner;
+
+/* initFilterScanner: initialize a filter scanner with empty sets.
+ *
+ * @source: the source string to tokenize.
+ *
+ * add token types to the statements and tokens sets before scanning, an
+ * empty filter produces nothing but errors and the end marker.
+ */
+void initFilterScanner(FilterScanner *scanner, const char *source);
+
+/* scanFiltered: scan the next token that passes the filter and return it.
+ *
+ * statements are delimited by newlines and semicolons; a compound statement
+ * is filtered by its header only, so the body of `if x: import y` written
+ * on the same line is skipped along with it. indentation is only tracked
+ * if INDENT or DEDENT tokens are asked for, otherwise line starts are
+ * skipped over and indentation errors go unreported. errors met while
+ * tokenizing and the end marker are always returned.
+ */
+Token scanFiltered(FilterScanner *scanner);
+
+#endif
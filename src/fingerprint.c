@@ -0,0 +1,148 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fingerprint.h"
+
+#define HASH_BASE 0x100000001b3ULL
+
+/* finalizer of splitmix64, spreads the bits of small token types. */
+static uint64_t mixHash(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t tokenHash(Fingerprinter const *fingerprinter, Token token) {
+    if (token.type != TOKEN_NAME || !fingerprinter->keep_names)
+        return mixHash(token.type + 1);
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < token.length; ++i) {
+        hash ^= (unsigned char)token.start[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return mixHash(hash);
+}
+
+void initFingerprinter(Fingerprinter *fingerprinter, int k, int window,
+    bool keep_names)
+{
+    fingerprinter->k = k < 1 ? 1
+        : k > FINGERPRINT_MAX_K ? FINGERPRINT_MAX_K : k;
+    fingerprinter->window = window < 1 ? 1
+        : window > FINGERPRINT_MAX_WINDOW ? FINGERPRINT_MAX_WINDOW : window;
+    fingerprinter->keep_names = keep_names;
+    fingerprinter->capacity = 0;
+    fingerprinter->fingerprints = NULL;
+
+    fingerprinter->power = 1;
+    for (int i = 0; i < fingerprinter->k; ++i)
+        fingerprinter->power *= HASH_BASE;
+
+    resetFingerprinter(fingerprinter);
+}
+
+void freeFingerprinter(Fingerprinter *fingerprinter) {
+    free(fingerprinter->fingerprints);
+    fingerprinter->fingerprints = NULL;
+    fingerprinter->capacity = 0;
+    fingerprinter->count = 0;
+}
+
+void resetFingerprinter(Fingerprinter *fingerprinter) {
+    fingerprinter->tokens = 0;
+    fingerprinter->hash = 0;
+    for (int i = 0; i < fingerprinter->k; ++i)
+        fingerprinter->token_hashes[i] = 0;
+    for (int i = 0; i < fingerprinter->window; ++i)
+        fingerprinter->hashes[i] = UINT64_MAX;
+    fingerprinter->right = 0;
+    fingerprinter->min = 0;
+    fingerprinter->count = 0;
+}
+
+static void addFingerprint(Fingerprinter *fingerprinter, int index) {
+    if (fingerprinter->count == fingerprinter->capacity) {
+        fingerprinter->capacity = fingerprinter->capacity < 8
+            ? 8 : fingerprinter->capacity * 2;
+        fingerprinter->fingerprints = realloc(fingerprinter->fingerprints,
+            fingerprinter->capacity * sizeof(Fingerprint));
+        if (!fingerprinter->fingerprints) {
+            fprintf(stderr, "error: not enough memory for fingerprints.\n");
+            exit(74);
+        }
+    }
+
+    fingerprinter->fingerprints[fingerprinter->count++] = (Fingerprint) {
+        .hash = fingerprinter->hashes[index],
+        .line = fingerprinter->lines[index]
+    };
+}
+
+/* select the smallest hash of each window, the rightmost one on ties, and
+ * add it unless it was already added for the previous window. */
+static void winnow(Fingerprinter *fingerprinter, uint64_t hash, int line) {
+    int window = fingerprinter->window;
+    int right = (fingerprinter->right + 1) % window;
+    uint64_t *hashes = fingerprinter->hashes;
+
+    fingerprinter->right = right;
+    hashes[right] = hash;
+    fingerprinter->lines[right] = line;
+
+    if (fingerprinter->min == right) {
+        // the smallest hash left the window, look for the next one.
+        int min = right;
+        for (int i = (right + window - 1) % window; i != right;
+            i = (i + window - 1) % window)
+        {
+            if (hashes[i] < hashes[min])
+                min = i;
+        }
+        fingerprinter->min = min;
+        addFingerprint(fingerprinter, min);
+    } else if (hash <= hashes[fingerprinter->min]) {
+        fingerprinter->min = right;
+        addFingerprint(fingerprinter, right);
+    }
+}
+
+void fingerprintToken(Fingerprinter *fingerprinter, Token token) {
+    if (token.type == TOKEN_ENDMARKER)
+        return;
+
+    int slot = fingerprinter->tokens % fingerprinter->k;
+    uint64_t hash = tokenHash(fingerprinter, token);
+
+    // the oldest token hash is 0 until k tokens are seen, so removing it
+    // does nothing.
+    fingerprinter->hash = fingerprinter->hash * HASH_BASE + hash
+        - fingerprinter->token_hashes[slot] * fingerprinter->power;
+    fingerprinter->token_hashes[slot] = hash;
+    fingerprinter->token_lines[slot] = token.line;
+
+    if (++fingerprinter->tokens < fingerprinter->k)
+        return;
+
+    // the slot after the newest one holds the oldest token of the k.
+    int first = fingerprinter->tokens % fingerprinter->k;
+    winnow(fingerprinter, fingerprinter->hash,
+        fingerprinter->token_lines[first]);
+}
+
+void fingerprintSource(Fingerprinter *fingerprinter, const char *source) {
+    Scanner scanner;
+    initScanner(&scanner, source);
+    resetFingerprinter(fingerprinter);
+
+    for (;;) {
+        Token token = scanToken(&scanner);
+        if (token.type == TOKEN_ENDMARKER)
+            break;
+        fingerprintToken(fingerprinter, token);
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef FINGERPRINT_H
+#define FINGERPRINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "scanner.h"
+
+#define FINGERPRINT_MAX_K 64
+#define FINGERPRINT_MAX_WINDOW 64
+
+/* Fingerprint: the hash of k consecutive normalized tokens.
+ *
+ * @hash: the hash of the tokens.
+ * @line: line of the first of the tokens.
+ */
+typedef struct {
+    uint64_t hash;
+    int line;
+} Fingerprint;
+
+/* Fingerprinter: selects fingerprints of a token stream by winnowing.
+ *
+ * each token is normalized to a hash: names are all the same unless
+ * keep_names is set, literals of a kind are all the same, any other token
+ * is its type. a rolling hash covers every k consecutive tokens, and the
+ * smallest of every window consecutive hashes is kept, so that any run of
+ * k + window - 1 tokens shared by two sources has a fingerprint in common.
+ *
+ * @k: number of tokens hashed together.
+ * @window: number of consecutive hashes to select one from.
+ * @keep_names: true to tell names apart.
+ * @tokens: number of tokens seen.
+ * @hash: rolling hash of the last k tokens.
+ * @power: the rolling hash base to the power k, to remove the oldest token.
+ * @token_hashes, @token_lines: last k token hashes and lines, as a ring.
+ * @hashes, @lines: last window rolling hashes and lines, as a ring.
+ * @right: index of the last rolling hash in the ring.
+ * @min: index of the smallest rolling hash in the ring.
+ * @count: number of fingerprints selected.
+ * @capacity: number of fingerprints that fit before growing.
+ * @fingerprints: the selected fingerprints, in source order.
+ */
+typedef struct {
+    int k;
+    int window;
+    bool keep_names;
+    long tokens;
+    uint64_t hash;
+    uint64_t power;
+    uint64_t token_hashes[FINGERPRINT_MAX_K];
+    int token_lines[FINGERPRINT_MAX_K];
+    uint64_t hashes[FINGERPRINT_MAX_WINDOW];
+    int lines[FINGERPRINT_MAX_WINDOW];
+    int right;
+    int min;
+    int count;
+    int capacity;
+    Fingerprint *fingerprints;
+} Fingerprinter;
+
+/* initFingerprinter: initialize a fingerprinter with no fingerprints.
+ *
+ * @k: number of tokens hashed together, at most FINGERPRINT_MAX_K.
+ * @window: number of consecutive hashes to select one from, at most
+ *      FINGERPRINT_MAX_WINDOW.
+ * @keep_names: true to tell names apart, false to treat them all alike.
+ */
+void initFingerprinter(Fingerprinter *fingerprinter, int k, int window,
+    bool keep_names);
+
+/* freeFingerprinter: free the fingerprints. */
+void freeFingerprinter(Fingerprinter *fingerprinter);
+
+/* resetFingerprinter: forget all tokens and fingerprints, keeping the
+ * settings and the memory. */
+void resetFingerprinter(Fingerprinter *fingerprinter);
+
+/* fingerprintToken: add the next token of a stream. */
+void fingerprintToken(Fingerprinter *fingerprinter, Token token);
+
+/* fingerprintSource: reset the fingerprinter and fingerprint a source. */
+void fingerprintSource(Fingerprinter *fingerprinter, const char *source);
+
+#endif
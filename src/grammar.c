@@ -0,0 +1,523 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "grammar.h"
+
+/* AUTO-GENERATED DO NOT MODIFY. see tools/generate_tokens.py. */
+
+const unsigned char Operator_Classes[256] = {
+    ['!'] = 1,
+    ['%'] = 2,
+    ['&'] = 3,
+    ['('] = 4,
+    [')'] = 5,
+    ['*'] = 6,
+    ['+'] = 7,
+    [','] = 8,
+    ['-'] = 9,
+    ['.'] = 10,
+    ['/'] = 11,
+    [':'] = 12,
+    [';'] = 13,
+    ['<'] = 14,
+    ['='] = 15,
+    ['>'] = 16,
+    ['@'] = 17,
+    ['['] = 18,
+    [']'] = 19,
+    ['^'] = 20,
+    ['{'] = 21,
+    ['|'] = 22,
+    ['}'] = 23,
+    ['~'] = 24,
+};
+
+static TokenType keywordType36(const char *name, int length) {
+    switch (length) {
+        case 2:
+            if (!memcmp(name, "as", 2))
+                return TOKEN_AS;
+            if (!memcmp(name, "if", 2))
+                return TOKEN_IF;
+            if (!memcmp(name, "in", 2))
+                return TOKEN_IN;
+            if (!memcmp(name, "is", 2))
+                return TOKEN_IS;
+            if (!memcmp(name, "or", 2))
+                return TOKEN_OR;
+            break;
+        case 3:
+            if (!memcmp(name, "and", 3))
+                return TOKEN_AND;
+            if (!memcmp(name, "def", 3))
+                return TOKEN_DEF;
+            if (!memcmp(name, "del", 3))
+                return TOKEN_DEL;
+            if (!memcmp(name, "for", 3))
+                return TOKEN_FOR;
+            if (!memcmp(name, "not", 3))
+                return TOKEN_NOT;
+            if (!memcmp(name, "try", 3))
+                return TOKEN_TRY;
+            break;
+        case 4:
+            if (!memcmp(name, "None", 4))
+                return TOKEN_NONE;
+            if (!memcmp(name, "True", 4))
+                return TOKEN_TRUE;
+            if (!memcmp(name, "elif", 4))
+                return TOKEN_ELIF;
+            if (!memcmp(name, "else", 4))
+                return TOKEN_ELSE;
+            if (!memcmp(name, "from", 4))
+                return TOKEN_FROM;
+            if (!memcmp(name, "pass", 4))
+                return TOKEN_PASS;
+            if (!memcmp(name, "with", 4))
+                return TOKEN_WITH;
+            break;
+        case 5:
+            if (!memcmp(name, "False", 5))
+                return TOKEN_FALSE;
+            if (!memcmp(name, "break", 5))
+                return TOKEN_BREAK;
+            if (!memcmp(name, "class", 5))
+                return TOKEN_CLASS;
+            if (!memcmp(name, "raise", 5))
+                return TOKEN_RAISE;
+            if (!memcmp(name, "while", 5))
+                return TOKEN_WHILE;
+            if (!memcmp(name, "yield", 5))
+                return TOKEN_YIELD;
+            break;
+        case 6:
+            if (!memcmp(name, "assert", 6))
+                return TOKEN_ASSERT;
+            if (!memcmp(name, "except", 6))
+                return TOKEN_EXCEPT;
+            if (!memcmp(name, "global", 6))
+                return TOKEN_GLOBAL;
+            if (!memcmp(name, "import", 6))
+                return TOKEN_IMPORT;
+            if (!memcmp(name, "lambda", 6))
+                return TOKEN_LAMBDA;
+            if (!memcmp(name, "return", 6))
+                return TOKEN_RETURN;
+            break;
+        case 7:
+            if (!memcmp(name, "finally", 7))
+                return TOKEN_FINALLY;
+            break;
+        case 8:
+            if (!memcmp(name, "continue", 8))
+                return TOKEN_CONTINUE;
+            if (!memcmp(name, "nonlocal", 8))
+                return TOKEN_NONLOCAL;
+            break;
+    }
+    return TOKEN_NAME;
+}
+
+static TokenType keywordType37(const char *name, int length) {
+    switch (length) {
+        case 2:
+            if (!memcmp(name, "as", 2))
+                return TOKEN_AS;
+            if (!memcmp(name, "if", 2))
+                return TOKEN_IF;
+            if (!memcmp(name, "in", 2))
+                return TOKEN_IN;
+            if (!memcmp(name, "is", 2))
+                return TOKEN_IS;
+            if (!memcmp(name, "or", 2))
+                return TOKEN_OR;
+            break;
+        case 3:
+            if (!memcmp(name, "and", 3))
+                return TOKEN_AND;
+            if (!memcmp(name, "def", 3))
+                return TOKEN_DEF;
+            if (!memcmp(name, "del", 3))
+                return TOKEN_DEL;
+            if (!memcmp(name, "for", 3))
+                return TOKEN_FOR;
+            if (!memcmp(name, "not", 3))
+                return TOKEN_NOT;
+            if (!memcmp(name, "try", 3))
+                return TOKEN_TRY;
+            break;
+        case 4:
+            if (!memcmp(name, "None", 4))
+                return TOKEN_NONE;
+            if (!memcmp(name, "True", 4))
+                return TOKEN_TRUE;
+            if (!memcmp(name, "elif", 4))
+                return TOKEN_ELIF;
+            if (!memcmp(name, "else", 4))
+                return TOKEN_ELSE;
+            if (!memcmp(name, "from", 4))
+                return TOKEN_FROM;
+            if (!memcmp(name, "pass", 4))
+                return TOKEN_PASS;
+            if (!memcmp(name, "with", 4))
+                return TOKEN_WITH;
+            break;
+        case 5:
+            if (!memcmp(name, "False", 5))
+                return TOKEN_FALSE;
+            if (!memcmp(name, "async", 5))
+                return TOKEN_ASYNC;
+            if (!memcmp(name, "await", 5))
+                return TOKEN_AWAIT;
+            if (!memcmp(name, "break", 5))
+                return TOKEN_BREAK;
+            if (!memcmp(name, "class", 5))
+                return TOKEN_CLASS;
+            if (!memcmp(name, "raise", 5))
+                return TOKEN_RAISE;
+            if (!memcmp(name, "while", 5))
+                return TOKEN_WHILE;
+            if (!memcmp(name, "yield", 5))
+                return TOKEN_YIELD;
+            break;
+        case 6:
+            if (!memcmp(name, "assert", 6))
+                return TOKEN_ASSERT;
+            if (!memcmp(name, "except", 6))
+                return TOKEN_EXCEPT;
+            if (!memcmp(name, "global", 6))
+                return TOKEN_GLOBAL;
+            if (!memcmp(name, "import", 6))
+                return TOKEN_IMPORT;
+            if (!memcmp(name, "lambda", 6))
+                return TOKEN_LAMBDA;
+            if (!memcmp(name, "return", 6))
+                return TOKEN_RETURN;
+            break;
+        case 7:
+            if (!memcmp(name, "finally", 7))
+                return TOKEN_FINALLY;
+            break;
+        case 8:
+            if (!memcmp(name, "continue", 8))
+                return TOKEN_CONTINUE;
+            if (!memcmp(name, "nonlocal", 8))
+                return TOKEN_NONLOCAL;
+            break;
+    }
+    return TOKEN_NAME;
+}
+
+static bool isSoftKeyword36(const char *name, int length) {
+    return false;
+}
+
+static bool isSoftKeyword310(const char *name, int length) {
+    switch (length) {
+        case 1:
+            if (!memcmp(name, "_", 1))
+                return true;
+            break;
+        case 4:
+            if (!memcmp(name, "case", 4))
+                return true;
+            break;
+        case 5:
+            if (!memcmp(name, "match", 5))
+                return true;
+            break;
+    }
+    return false;
+}
+
+static bool isSoftKeyword312(const char *name, int length) {
+    switch (length) {
+        case 1:
+            if (!memcmp(name, "_", 1))
+                return true;
+            break;
+        case 4:
+            if (!memcmp(name, "case", 4))
+                return true;
+            if (!memcmp(name, "type", 4))
+                return true;
+            break;
+        case 5:
+            if (!memcmp(name, "match", 5))
+                return true;
+            break;
+    }
+    return false;
+}
+
+static const unsigned char operator_next36[][25] = {
+    {0, 1, 3, 5, 7, 8, 9, 13, 15, 16, 19, 22, 26, 27, 28, 32, 34, 38, 40, 41, 42, 44, 45, 47, 48},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 12, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 11, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 14, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 17, 18, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 21, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 23, 0, 0, 0, 25, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 24, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 29, 31, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 30, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 33, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 35, 36, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 37, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 39, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 43, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 46, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+};
+
+static const unsigned char operator_accept36[] = {
+    TOKEN_ERROR,
+    TOKEN_ERROR,
+    TOKEN_NOTEQUAL,
+    TOKEN_PERCENT,
+    TOKEN_PERCENTEQUAL,
+    TOKEN_AMPER,
+    TOKEN_AMPEREQUAL,
+    TOKEN_LPAR,
+    TOKEN_RPAR,
+    TOKEN_STAR,
+    TOKEN_DOUBLESTAR,
+    TOKEN_DOUBLESTAREQUAL,
+    TOKEN_STAREQUAL,
+    TOKEN_PLUS,
+    TOKEN_PLUSEQUAL,
+    TOKEN_COMMA,
+    TOKEN_MINUS,
+    TOKEN_MINEQUAL,
+    TOKEN_RARROW,
+    TOKEN_DOT,
+    TOKEN_ERROR,
+    TOKEN_ELLIPSIS,
+    TOKEN_SLASH,
+    TOKEN_DOUBLESLASH,
+    TOKEN_DOUBLESLASHEQUAL,
+    TOKEN_SLASHEQUAL,
+    TOKEN_COLON,
+    TOKEN_SEMI,
+    TOKEN_LESS,
+    TOKEN_LEFTSHIFT,
+    TOKEN_LEFTSHIFTEQUAL,
+    TOKEN_LESSEQUAL,
+    TOKEN_EQUAL,
+    TOKEN_EQEQUAL,
+    TOKEN_GREATER,
+    TOKEN_GREATEREQUAL,
+    TOKEN_RIGHTSHIFT,
+    TOKEN_RIGHTSHIFTEQUAL,
+    TOKEN_AT,
+    TOKEN_ATEQUAL,
+    TOKEN_LSQB,
+    TOKEN_RSQB,
+    TOKEN_CIRCUMFLEX,
+    TOKEN_CIRCUMFLEXEQUAL,
+    TOKEN_LBRACE,
+    TOKEN_VBAR,
+    TOKEN_VBAREQUAL,
+    TOKEN_RBRACE,
+    TOKEN_TILDE,
+};
+
+static const unsigned char operator_next38[][25] = {
+    {0, 1, 3, 5, 7, 8, 9, 13, 15, 16, 19, 22, 26, 28, 29, 33, 35, 39, 41, 42, 43, 45, 46, 48, 49},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 12, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 11, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 14, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 17, 18, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 21, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 23, 0, 0, 0, 25, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 24, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 27, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 30, 32, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 31, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 34, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 36, 37, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 38, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 40, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 44, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 47, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+};
+
+static const unsigned char operator_accept38[] = {
+    TOKEN_ERROR,
+    TOKEN_ERROR,
+    TOKEN_NOTEQUAL,
+    TOKEN_PERCENT,
+    TOKEN_PERCENTEQUAL,
+    TOKEN_AMPER,
+    TOKEN_AMPEREQUAL,
+    TOKEN_LPAR,
+    TOKEN_RPAR,
+    TOKEN_STAR,
+    TOKEN_DOUBLESTAR,
+    TOKEN_DOUBLESTAREQUAL,
+    TOKEN_STAREQUAL,
+    TOKEN_PLUS,
+    TOKEN_PLUSEQUAL,
+    TOKEN_COMMA,
+    TOKEN_MINUS,
+    TOKEN_MINEQUAL,
+    TOKEN_RARROW,
+    TOKEN_DOT,
+    TOKEN_ERROR,
+    TOKEN_ELLIPSIS,
+    TOKEN_SLASH,
+    TOKEN_DOUBLESLASH,
+    TOKEN_DOUBLESLASHEQUAL,
+    TOKEN_SLASHEQUAL,
+    TOKEN_COLON,
+    TOKEN_COLONEQUAL,
+    TOKEN_SEMI,
+    TOKEN_LESS,
+    TOKEN_LEFTSHIFT,
+    TOKEN_LEFTSHIFTEQUAL,
+    TOKEN_LESSEQUAL,
+    TOKEN_EQUAL,
+    TOKEN_EQEQUAL,
+    TOKEN_GREATER,
+    TOKEN_GREATEREQUAL,
+    TOKEN_RIGHTSHIFT,
+    TOKEN_RIGHTSHIFTEQUAL,
+    TOKEN_AT,
+    TOKEN_ATEQUAL,
+    TOKEN_LSQB,
+    TOKEN_RSQB,
+    TOKEN_CIRCUMFLEX,
+    TOKEN_CIRCUMFLEXEQUAL,
+    TOKEN_LBRACE,
+    TOKEN_VBAR,
+    TOKEN_VBAREQUAL,
+    TOKEN_RBRACE,
+    TOKEN_TILDE,
+};
+
+const Grammar Grammars[PYTHON_VERSION_COUNT] = {
+    [PYTHON_3_6] = {
+        .keyword = keywordType36,
+        .is_soft_keyword = isSoftKeyword36,
+        .operator_next = operator_next36,
+        .operator_accept = operator_accept36
+    },
+    [PYTHON_3_7] = {
+        .keyword = keywordType37,
+        .is_soft_keyword = isSoftKeyword36,
+        .operator_next = operator_next36,
+        .operator_accept = operator_accept36
+    },
+    [PYTHON_3_8] = {
+        .keyword = keywordType37,
+        .is_soft_keyword = isSoftKeyword36,
+        .operator_next = operator_next38,
+        .operator_accept = operator_accept38
+    },
+    [PYTHON_3_9] = {
+        .keyword = keywordType37,
+        .is_soft_keyword = isSoftKeyword36,
+        .operator_next = operator_next38,
+        .operator_accept = operator_accept38
+    },
+    [PYTHON_3_10] = {
+        .keyword = keywordType37,
+        .is_soft_keyword = isSoftKeyword310,
+        .operator_next = operator_next38,
+        .operator_accept = operator_accept38
+    },
+    [PYTHON_3_11] = {
+        .keyword = keywordType37,
+        .is_soft_keyword = isSoftKeyword310,
+        .operator_next = operator_next38,
+        .operator_accept = operator_accept38
+    },
+    [PYTHON_3_12] = {
+        .keyword = keywordType37,
+        .is_soft_keyword = isSoftKeyword312,
+        .operator_next = operator_next38,
+        .operator_accept = operator_accept38
+    },
+    [PYTHON_3_13] = {
+        .keyword = keywordType37,
+        .is_soft_keyword = isSoftKeyword312,
+        .operator_next = operator_next38,
+        .operator_accept = operator_accept38
+    },
+};
+
+const char * const Python_Version_Names[PYTHON_VERSION_COUNT] = {
+    "3.6",
+    "3.7",
+    "3.8",
+    "3.9",
+    "3.10",
+    "3.11",
+    "3.12",
+    "3.13",
+};
@@ -0,0 +1,54 @@
+#ifndef GRAMMAR_H
+#define GRAMMAR_H
+
+/* AUTO-GENERATED DO NOT MODIFY. see tools/generate_tokens.py. */
+
+#include <stdbool.h>
+
+#include "token.h"
+
+typedef enum {
+    PYTHON_3_6,
+    PYTHON_3_7,
+    PYTHON_3_8,
+    PYTHON_3_9,
+    PYTHON_3_10,
+    PYTHON_3_11,
+    PYTHON_3_12,
+    PYTHON_3_13,
+    PYTHON_VERSION_COUNT
+} PythonVersion;
+
+#define PYTHON_LATEST PYTHON_3_13
+
+/* number of operator character classes, class 0 is for characters
+ * that are not part of any operator. */
+#define OPERATOR_CLASSES 25
+
+/* Grammar: the lexical grammar of a python version.
+ *
+ * @keyword: return the keyword type of a name, or TOKEN_NAME.
+ * @is_soft_keyword: return true if a name is a soft keyword.
+ * @operator_next: operator DFA transitions, from a state and the class
+ *      of the next character to the next state, or 0 if there is none.
+ *      the DFA starts in state 0.
+ * @operator_accept: type of the operator ending in each state, or
+ *      TOKEN_ERROR.
+ */
+typedef struct {
+    TokenType (*keyword)(const char *name, int length);
+    bool (*is_soft_keyword)(const char *name, int length);
+    const unsigned char (*operator_next)[OPERATOR_CLASSES];
+    const unsigned char *operator_accept;
+} Grammar;
+
+/* class of each character in the operator DFA. */
+extern const unsigned char Operator_Classes[256];
+
+/* grammar of each python version. */
+extern const Grammar Grammars[PYTHON_VERSION_COUNT];
+
+/* name of each python version, as in "3.6". */
+extern const char * const Python_Version_Names[PYTHON_VERSION_COUNT];
+
+#endif
@@ -1,38 +1,33 @@
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "checkpoint.h"
+#include "corpus.h"
+#include "diff.h"
+#include "filter.h"
+#include "fingerprint.h"
+#include "metrics.h"
+#include "minify.h"
+#include "query.h"
 #include "scanner.h"
+#include "serve.h"
+#include "structure.h"
+#include "trivia.h"
+#include "walk.h"
 
-static char *readFile(const char *path) {
-    FILE *file = fopen(path, "rb");
-    if (!file) {
-        fprintf(stderr, "error: could not open file \"%s\".\n", path);
-        exit(10);
-    }
-
-    fseek(file, 0L, SEEK_END);
-    size_t filesize = ftell(file);
-    rewind(file);
-
-    char *source = malloc (filesize + 1);
-    if (!source) {
-        fprintf(stderr, "error: not enough memory to read \"%s\".\n", path);
-        exit(74);
-    }
+#define CHECKPOINT_INTERVAL 256
+#define CHECKPOINT_SUFFIX ".tokidx"
+#define FINGERPRINT_K 12
+#define FINGERPRINT_WINDOW 8
 
-    const size_t objects_num = filesize / sizeof(*source);
-    size_t bytes_read = fread(source, sizeof(*source), objects_num, file);
-    if (bytes_read < objects_num) {
-        fprintf(stderr, "error: could not read file \"%s\".\n", path);
+/* read a file given on the command line, exiting if it cannot be. */
+static char *readFileOrExit(const char *path) {
+    char *source = readFile(path);
+    if (!source)
         exit(74);
-    }
-
-    source[bytes_read] = '\0';
-
-    fclose(file);
-
     return source;
 }
 
@@ -71,11 +66,66 @@ static void printToken(Token const token) {
     }
 }
 
-static void runFile(const char *path) {
-    char *source = readFile(path);
+static void printTokenFunc(Token token, void *data) {
+    printToken(token);
+}
+
+static char *indexPath(const char *path) {
+    char *index_path = malloc(strlen(path) + sizeof(CHECKPOINT_SUFFIX));
+    if (!index_path) {
+        fprintf(stderr, "error: not enough memory to index \"%s\".\n", path);
+        exit(74);
+    }
+    strcpy(index_path, path);
+    strcat(index_path, CHECKPOINT_SUFFIX);
+    return index_path;
+}
+
+static void indexFile(const char *path) {
+    char *source = readFileOrExit(path);
+    char *index_path = indexPath(path);
+
+    CheckpointIndex index;
+    initCheckpointIndex(&index, source, CHECKPOINT_INTERVAL);
+    buildCheckpointIndex(&index);
+
+    FILE *file = fopen(index_path, "wb");
+    if (!file || !writeCheckpointIndex(&index, file)) {
+        fprintf(stderr, "error: could not write file \"%s\".\n", index_path);
+        exit(74);
+    }
+    fclose(file);
+
+    freeCheckpointIndex(&index);
+    free(index_path);
+    free(source);
+}
+
+static void runRange(const char *path, int first, int last) {
+    char *source = readFileOrExit(path);
+    char *index_path = indexPath(path);
+
+    // use the index stored next to the file if it is still valid.
+    CheckpointIndex index;
+    initCheckpointIndex(&index, source, CHECKPOINT_INTERVAL);
+    FILE *file = fopen(index_path, "rb");
+    if (!file || !readCheckpointIndex(&index, file))
+        buildCheckpointIndex(&index);
+    if (file)
+        fclose(file);
+
+    tokenizeRange(&index, first, last, printTokenFunc, NULL);
+
+    freeCheckpointIndex(&index);
+    free(index_path);
+    free(source);
+}
+
+static void runFile(const char *path, PythonVersion version) {
+    char *source = readFileOrExit(path);
 
     Scanner scanner;
-    initScanner(&scanner, source);
+    initScannerVersion(&scanner, source, version);
     for (Token tok = scanToken(&scanner);
         tok.type != TOKEN_ENDMARKER;
         tok = scanToken(&scanner))
@@ -86,10 +136,432 @@ static void runFile(const char *path) {
     free(source);
 }
 
+static void printEditTokens(char sign, TokenSequence const *sequence,
+    int start, int count)
+{
+    for (int i = start; i < start + count; ++i) {
+        putchar(sign);
+        printToken(sequence->tokens[i]);
+    }
+}
+
+static int runDiff(const char *old_path, const char *new_path) {
+    char *old_source = readFileOrExit(old_path);
+    char *new_source = readFileOrExit(new_path);
+
+    TokenSequence old_tokens, new_tokens;
+    TokenDiff diff;
+    initTokenSequence(&old_tokens);
+    initTokenSequence(&new_tokens);
+    initTokenDiff(&diff);
+    if (!tokenizeSequence(&old_tokens, old_source)
+        || !tokenizeSequence(&new_tokens, new_source)
+        || diffTokens(&diff, &old_tokens, &new_tokens) < 0)
+    {
+        fprintf(stderr, "error: not enough memory to diff \"%s\" and "
+            "\"%s\".\n", old_path, new_path);
+        exit(74);
+    }
+
+    // each edit is headed by the position of its first token, or of the
+    // token it comes before if it has none, and its number of tokens.
+    for (int i = 0; i < diff.count; ++i) {
+        TokenEdit const *edit = &diff.edits[i];
+        Token const *old_first = &old_tokens.tokens[edit->old_start];
+        Token const *new_first = &new_tokens.tokens[edit->new_start];
+        printf("@@ -%d:%d,%d +%d:%d,%d @@\n", old_first->line,
+            old_first->column, edit->old_count, new_first->line,
+            new_first->column, edit->new_count);
+        printEditTokens('-', &old_tokens, edit->old_start, edit->old_count);
+        printEditTokens('+', &new_tokens, edit->new_start, edit->new_count);
+    }
+
+    int status = diff.count > 0;
+    freeTokenDiff(&diff);
+    freeTokenSequence(&old_tokens);
+    freeTokenSequence(&new_tokens);
+    free(old_source);
+    free(new_source);
+    return status;
+}
+
+static int runMinify(const char *path, bool drop_docstrings) {
+    char *source = readFileOrExit(path);
+    Minifier minifier;
+    initMinifier(&minifier, drop_docstrings);
+
+    int status = 0;
+    if (!minifySource(&minifier, source)) {
+        Token const *error = &minifier.error;
+        fprintf(stderr, "error: could not minify \"%s\", line %d: %.*s.\n",
+            path, error->line, error->length, error->start);
+        status = 65;
+    } else if (!writeMinified(&minifier, 1)) {
+        fprintf(stderr, "error: could not write the minified \"%s\".\n",
+            path);
+        status = 74;
+    }
+
+    freeMinifier(&minifier);
+    free(source);
+    return status;
+}
+
+static void printTrivia(Trivia const *trivia, const char *source) {
+    printf("        \t %-16s \'", Trivia_Names[trivia->type]);
+    printRepr(source + trivia->offset, trivia->length);
+    puts("\'");
+}
+
+static void runTrivia(const char *path) {
+    char *source = readFileOrExit(path);
+
+    TriviaScanner scanner;
+    initTriviaScanner(&scanner, source);
+    TriviaTable const *table = &scanner.table;
+    int printed = 0;
+    for (;;) {
+        Token tok = scanTrivia(&scanner);
+
+        // the trivia of a token is recorded when the token is scanned.
+        for (; printed < table->count; ++printed)
+            printTrivia(&table->trivia[printed], source);
+
+        if (tok.type == TOKEN_ENDMARKER)
+            break;
+        printToken(tok);
+    }
+
+    freeTriviaScanner(&scanner);
+    free(source);
+}
+
+typedef enum {
+    IMPORT_NONE,
+    IMPORT_MODULES,     // import module, ...
+    IMPORT_FROM,        // from module
+    IMPORT_FROM_NAMES   // from module import name, ...
+} ImportKind;
+
+/* ImportState: tracks the import statement being printed.
+ *
+ * @path: path of the file being scanned.
+ * @kind: the part of an import statement being scanned.
+ * @is_alias: true after `as`, until the next module.
+ * @in_module: true while printing a module name.
+ */
+typedef struct {
+    const char *path;
+    ImportKind kind;
+    bool is_alias;
+    bool in_module;
+} ImportState;
+
+static void endModule(ImportState *state) {
+    if (state->in_module) {
+        putchar('\n');
+        state->in_module = false;
+    }
+}
+
+static void printImportToken(ImportState *state, Token const token) {
+    switch (token.type) {
+        case TOKEN_IMPORT:
+            endModule(state);
+            state->kind = state->kind == IMPORT_FROM
+                ? IMPORT_FROM_NAMES : IMPORT_MODULES;
+            break;
+        case TOKEN_FROM:
+            state->kind = IMPORT_FROM;
+            break;
+        case TOKEN_NAME:
+        case TOKEN_DOT:
+        case TOKEN_ELLIPSIS:
+            if (state->is_alias || (state->kind != IMPORT_MODULES
+                && state->kind != IMPORT_FROM))
+                break;
+            if (!state->in_module) {
+                printf("%s\t", state->path);
+                state->in_module = true;
+            }
+            fwrite(token.start, 1, token.length, stdout);
+            break;
+        case TOKEN_AS:
+            endModule(state);
+            state->is_alias = true;
+            break;
+        case TOKEN_COMMA:
+            endModule(state);
+            state->is_alias = false;
+            break;
+        default:
+            endModule(state);
+            state->kind = IMPORT_NONE;
+            state->is_alias = false;
+            break;
+    }
+}
+
+static void printImports(const char *path, const char *source, void *data) {
+    static const TokenType token_types[] = {
+        TOKEN_IMPORT, TOKEN_FROM, TOKEN_NAME, TOKEN_DOT, TOKEN_ELLIPSIS,
+        TOKEN_AS, TOKEN_COMMA, TOKEN_NEWLINE, TOKEN_SEMI
+    };
+    FilterScanner scanner;
+    initFilterScanner(&scanner, source);
+    tokenSetAdd(&scanner.statements, TOKEN_IMPORT);
+    tokenSetAdd(&scanner.statements, TOKEN_FROM);
+    for (size_t i = 0; i < sizeof(token_types) / sizeof(*token_types); ++i)
+        tokenSetAdd(&scanner.tokens, token_types[i]);
+
+    ImportState state = { .path = path };
+    for (Token tok = scanFiltered(&scanner);
+        tok.type != TOKEN_ENDMARKER;
+        tok = scanFiltered(&scanner))
+    {
+        printImportToken(&state, tok);
+    }
+    endModule(&state);
+}
+
+static void printFileMetrics(const char *path, const char *source,
+    void *data)
+{
+    Metrics *tree = data;
+
+    Metrics metrics;
+    initMetrics(&metrics);
+    measureSource(&metrics, source);
+    printMetrics(stdout, "file", path, &metrics);
+    addMetrics(tree, &metrics);
+}
+
+static void printTreeMetrics(const char *path) {
+    Metrics tree;
+    initMetrics(&tree);
+    walkTree(path, printFileMetrics, &tree);
+    printMetrics(stdout, "tree", path, &tree);
+}
+
+static char bracketChar(TokenType type) {
+    switch (type) {
+        case TOKEN_LPAR: return '(';
+        case TOKEN_RPAR: return ')';
+        case TOKEN_LSQB: return '[';
+        case TOKEN_RSQB: return ']';
+        case TOKEN_LBRACE: return '{';
+        case TOKEN_RBRACE: return '}';
+        default: return '?';
+    }
+}
+
+static void printMismatch(const char *path, Mismatch const *mismatch) {
+    if (mismatch->open < 0) {
+        printf("%s:%d:%d: unmatched '%c'\n", path,
+            mismatch->close_line, mismatch->close_column,
+            bracketChar(mismatch->close_type));
+    } else if (mismatch->close < 0) {
+        printf("%s:%d:%d: '%c' was never closed\n", path,
+            mismatch->open_line, mismatch->open_column,
+            bracketChar(mismatch->open_type));
+    } else {
+        printf("%s:%d:%d: '%c' does not match '%c' at %d:%d\n", path,
+            mismatch->close_line, mismatch->close_column,
+            bracketChar(mismatch->close_type),
+            bracketChar(mismatch->open_type),
+            mismatch->open_line, mismatch->open_column);
+    }
+}
+
+static void checkStructure(const char *path, const char *source, void *data) {
+    bool *has_mismatches = data;
+
+    Scanner scanner;
+    StructureIndex index;
+    initScanner(&scanner, source);
+    initStructureIndex(&index);
+    for (;;) {
+        Token tok = scanToken(&scanner);
+        indexStructure(&index, tok);
+        if (tok.type == TOKEN_ENDMARKER)
+            break;
+    }
+
+    for (int i = 0; i < index.mismatches_count; ++i)
+        printMismatch(path, &index.mismatches[i]);
+    if (index.mismatches_count > 0)
+        *has_mismatches = true;
+
+    freeStructureIndex(&index);
+}
+
+static PythonVersion parseVersion(const char *name) {
+    for (int version = 0; version < PYTHON_VERSION_COUNT; ++version) {
+        if (!strcmp(name, Python_Version_Names[version]))
+            return version;
+    }
+
+    fprintf(stderr, "error: unsupported python version \"%s\", expected %s "
+        "to %s.\n", name, Python_Version_Names[0],
+        Python_Version_Names[PYTHON_VERSION_COUNT - 1]);
+    exit(64);
+}
+
+static void printFingerprints(const char *path, const char *source,
+    void *data)
+{
+    Fingerprinter *fingerprinter = data;
+
+    fingerprintSource(fingerprinter, source);
+
+    fputs(path, stdout);
+    for (int i = 0; i < fingerprinter->count; ++i) {
+        Fingerprint const *fingerprint = &fingerprinter->fingerprints[i];
+        printf("%c%d:%016" PRIx64, i ? ' ' : '\t', fingerprint->line,
+            fingerprint->hash);
+    }
+    putchar('\n');
+}
+
+static void runFingerprints(int count, char *paths[]) {
+    bool keep_names = count > 0 && !strcmp(paths[0], "--names");
+    if (keep_names) {
+        --count;
+        ++paths;
+    }
+
+    Fingerprinter fingerprinter;
+    initFingerprinter(&fingerprinter, FINGERPRINT_K, FINGERPRINT_WINDOW,
+        keep_names);
+    for (int i = 0; i < count; ++i)
+        walkTree(paths[i], printFingerprints, &fingerprinter);
+    freeFingerprinter(&fingerprinter);
+}
+
+/* QueryState: a query run over the files of a tree.
+ *
+ * @query: the compiled query.
+ * @has_matches: true once any file matched.
+ */
+typedef struct {
+    Query query;
+    bool has_matches;
+} QueryState;
+
+static void printMatches(const char *path, const char *source, void *data) {
+    QueryState *state = data;
+    if (runQuery(&state->query, source, strlen(source)) == 0)
+        return;
+
+    state->has_matches = true;
+    for (int i = 0; i < state->query.matches_count; ++i) {
+        QueryMatch const *match = &state->query.matches[i];
+        const char *line = source + match->offset;
+        while (line > source && line[-1] != '\n')
+            --line;
+        int length = strcspn(line, "\n");
+        printf("%s:%d:%d: %.*s\n", path, match->line, match->column,
+            length, line);
+    }
+}
+
+static int runQueries(const char *pattern, int count, char *paths[]) {
+    QueryState state = {.has_matches = false};
+    if (!compileQuery(&state.query, pattern)) {
+        fprintf(stderr, "error: invalid query \"%s\": %s.\n", pattern,
+            state.query.error);
+        freeQuery(&state.query);
+        exit(64);
+    }
+
+    for (int i = 0; i < count; ++i)
+        walkTree(paths[i], printMatches, &state);
+    freeQuery(&state.query);
+    return state.has_matches ? 0 : 1;
+}
+
+static int runExport(int count, char *paths[]) {
+    uint32_t flags = 0;
+    if (count > 0 && !strcmp(paths[0], "--ids")) {
+        flags |= CORPUS_IDS;
+        --count;
+        ++paths;
+    }
+    if (count < 2) {
+        fprintf(stderr, "error: expected an output directory and paths.\n");
+        exit(64);
+    }
+
+    Corpus corpus;
+    initCorpus(&corpus, paths[0], flags, CORPUS_SHARD_TOKENS);
+    startExport(&corpus, 0);
+    for (int i = 1; i < count; ++i)
+        walkTree(paths[i], exportDocument, &corpus);
+    bool is_written = finishExport(&corpus);
+
+    printf("%" PRIu64 " documents, %" PRIu64 " tokens, %" PRIu32 " shards, "
+        "%" PRIu64 " duplicates and %" PRIu64 " with errors skipped\n",
+        corpus.documents, corpus.tokens, corpus.shards, corpus.duplicates,
+        corpus.invalid);
+    freeCorpus(&corpus);
+    return is_written ? 0 : 74;
+}
+
+static void usage(const char *program) {
+    printf("usage: %s [--python version] filepath\n", program);
+    printf("       %s --imports path...\n", program);
+    printf("       %s --metrics path...\n", program);
+    printf("       %s --fingerprint [--names] path...\n", program);
+    printf("       %s --structure path...\n", program);
+    printf("       %s --query pattern path...\n", program);
+    printf("       %s --export [--ids] directory path...\n", program);
+    printf("       %s --trivia filepath\n", program);
+    printf("       %s --diff oldpath newpath\n", program);
+    printf("       %s --minify [--drop-docstrings] filepath\n", program);
+    printf("       %s --serve socketpath\n", program);
+    printf("       %s --index filepath\n", program);
+    printf("       %s --range first last filepath\n", program);
+}
+
 int main(int argc, char *argv[]) {
-    if (argc == 2) {
-        runFile(argv[1]);
+    if (argc >= 3 && !strcmp(argv[1], "--imports")) {
+        for (int i = 2; i < argc; ++i)
+            walkTree(argv[i], printImports, NULL);
+    } else if (argc >= 3 && !strcmp(argv[1], "--metrics")) {
+        for (int i = 2; i < argc; ++i)
+            printTreeMetrics(argv[i]);
+    } else if (argc >= 3 && !strcmp(argv[1], "--fingerprint")) {
+        runFingerprints(argc - 2, argv + 2);
+    } else if (argc >= 4 && !strcmp(argv[1], "--query")) {
+        return runQueries(argv[2], argc - 3, argv + 3);
+    } else if (argc >= 4 && !strcmp(argv[1], "--export")) {
+        return runExport(argc - 2, argv + 2);
+    } else if (argc >= 3 && !strcmp(argv[1], "--structure")) {
+        bool has_mismatches = false;
+        for (int i = 2; i < argc; ++i)
+            walkTree(argv[i], checkStructure, &has_mismatches);
+        return has_mismatches;
+    } else if (argc == 3 && !strcmp(argv[1], "--trivia")) {
+        runTrivia(argv[2]);
+    } else if (argc == 4 && !strcmp(argv[1], "--diff")) {
+        return runDiff(argv[2], argv[3]);
+    } else if (argc == 3 && !strcmp(argv[1], "--minify")) {
+        return runMinify(argv[2], false);
+    } else if (argc == 4 && !strcmp(argv[1], "--minify")
+        && !strcmp(argv[2], "--drop-docstrings"))
+    {
+        return runMinify(argv[3], true);
+    } else if (argc == 3 && !strcmp(argv[1], "--serve")) {
+        return serve(argv[2], 0);
+    } else if (argc == 3 && !strcmp(argv[1], "--index")) {
+        indexFile(argv[2]);
+    } else if (argc == 5 && !strcmp(argv[1], "--range")) {
+        runRange(argv[4], atoi(argv[2]), atoi(argv[3]));
+    } else if (argc == 4 && !strcmp(argv[1], "--python")) {
+        runFile(argv[3], parseVersion(argv[2]));
+    } else if (argc == 2) {
+        runFile(argv[1], PYTHON_LATEST);
     } else {
-        printf("usage: %s filepath\n", argv[0]);
+        usage(argv[0]);
     }
 }
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "metrics.h"
+
+void initMetrics(Metrics *metrics) {
+    memset(metrics, 0, sizeof(*metrics));
+}
+
+/* count the comments in the text skipped by the scanner between two
+ * tokens, which holds nothing else but whitespace and line breaks. */
+static void measureGap(Metrics *metrics, const char *start, const char *end) {
+    while ((start = memchr(start, '#', end - start))) {
+        const char *comment_end = memchr(start, '\n', end - start);
+        if (!comment_end)
+            comment_end = end;
+
+        ++metrics->comment_lines;
+        metrics->comment_bytes += comment_end - start;
+        start = comment_end;
+    }
+}
+
+void measureSource(Metrics *metrics, const char *source) {
+    Scanner scanner;
+    initScanner(&scanner, source);
+    ++metrics->files;
+
+    for (;;) {
+        const char *gap = scanner.current;
+        Token token = scanToken(&scanner);
+        measureGap(metrics, gap, scanner.start);
+
+        ++metrics->tokens[token.type];
+        if (scanner.level > metrics->max_level)
+            metrics->max_level = scanner.level;
+
+        switch (token.type) {
+            case TOKEN_INDENT:
+                if (scanner.indent > metrics->max_indent)
+                    metrics->max_indent = scanner.indent;
+                break;
+            case TOKEN_NEWLINE:
+                ++metrics->logical_lines;
+                break;
+            case TOKEN_STRING:
+                ++metrics->strings;
+                metrics->string_bytes += token.length;
+                if (token.length > metrics->max_string)
+                    metrics->max_string = token.length;
+                break;
+            case TOKEN_NUMBER:
+                ++metrics->numbers;
+                metrics->number_bytes += token.length;
+                if (token.length > metrics->max_number)
+                    metrics->max_number = token.length;
+                break;
+            case TOKEN_ERROR:
+                ++metrics->errors;
+                break;
+            default:
+                break;
+        }
+
+        if (token.type == TOKEN_ENDMARKER)
+            break;
+    }
+
+    // the scanner has consumed the whole source by now.
+    metrics->bytes += scanner.current - source;
+    metrics->physical_lines += scanner.current_line - 1
+        + (scanner.current_column > 0);
+}
+
+void addMetrics(Metrics *metrics, Metrics const *other) {
+    metrics->files += other->files;
+    metrics->bytes += other->bytes;
+    metrics->physical_lines += other->physical_lines;
+    metrics->logical_lines += other->logical_lines;
+    metrics->comment_lines += other->comment_lines;
+    metrics->comment_bytes += other->comment_bytes;
+    if (other->max_indent > metrics->max_indent)
+        metrics->max_indent = other->max_indent;
+    if (other->max_level > metrics->max_level)
+        metrics->max_level = other->max_level;
+    metrics->strings += other->strings;
+    metrics->string_bytes += other->string_bytes;
+    if (other->max_string > metrics->max_string)
+        metrics->max_string = other->max_string;
+    metrics->numbers += other->numbers;
+    metrics->number_bytes += other->number_bytes;
+    if (other->max_number > metrics->max_number)
+        metrics->max_number = other->max_number;
+    metrics->errors += other->errors;
+    for (int i = 0; i < TOKEN_COUNT; ++i)
+        metrics->tokens[i] += other->tokens[i];
+}
+
+static void printJsonString(FILE *file, const char *string) {
+    fputc('"', file);
+    for (; *string; ++string) {
+        unsigned char c = *string;
+        if (c == '"' || c == '\\')
+            fprintf(file, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(file, "\\u%04x", c);
+        else
+            fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+void printMetrics(FILE *file, const char *kind, const char *path,
+    Metrics const *metrics)
+{
+    fprintf(file, "{\"%s\":", kind);
+    printJsonString(file, path);
+    fprintf(file,
+        ",\"files\":%ld,\"bytes\":%ld"
+        ",\"physical_lines\":%ld,\"logical_lines\":%ld"
+        ",\"comment_lines\":%ld,\"comment_bytes\":%ld"
+        ",\"comment_density\":%.4f"
+        ",\"max_indent\":%d,\"max_level\":%d"
+        ",\"strings\":%ld,\"string_bytes\":%ld,\"max_string\":%d"
+        ",\"numbers\":%ld,\"number_bytes\":%ld,\"max_number\":%d"
+        ",\"errors\":%ld,\"tokens\":{",
+        metrics->files, metrics->bytes,
+        metrics->physical_lines, metrics->logical_lines,
+        metrics->comment_lines, metrics->comment_bytes,
+        metrics->physical_lines
+            ? (double)metrics->comment_lines / metrics->physical_lines : 0.0,
+        metrics->max_indent, metrics->max_level,
+        metrics->strings, metrics->string_bytes, metrics->max_string,
+        metrics->numbers, metrics->number_bytes, metrics->max_number,
+        metrics->errors);
+
+    // only the token types that occur, to keep the report compact.
+    bool first = true;
+    for (int i = 0; i < TOKEN_COUNT; ++i) {
+        if (!metrics->tokens[i])
+            continue;
+        fprintf(file, "%s", first ? "" : ",");
+        printJsonString(file, Token_Names[i]);
+        fprintf(file, ":%ld", metrics->tokens[i]);
+        first = false;
+    }
+
+    fputs("}}\n", file);
+}
@@ -0,0 +1,60 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+
+#include "scanner.h"
+
+/* Metrics: code statistics gathered while scanning.
+ *
+ * @files: number of files measured.
+ * @bytes: size of the sources in bytes.
+ * @physical_lines: number of lines.
+ * @logical_lines: number of logical lines, i.e. NEWLINE tokens.
+ * @comment_lines: number of lines with a comment.
+ * @comment_bytes: size of the comments in bytes.
+ * @max_indent: deepest indentation, in indent levels.
+ * @max_level: deepest bracket nesting.
+ * @strings, @string_bytes, @max_string: count, total and largest size of
+ *      string literals.
+ * @numbers, @number_bytes, @max_number: same for number literals.
+ * @errors: number of error tokens.
+ * @tokens: number of tokens of each type.
+ */
+typedef struct {
+    long files;
+    long bytes;
+    long physical_lines;
+    long logical_lines;
+    long comment_lines;
+    long comment_bytes;
+    int max_indent;
+    int max_level;
+    long strings;
+    long string_bytes;
+    int max_string;
+    long numbers;
+    long number_bytes;
+    int max_number;
+    long errors;
+    long tokens[TOKEN_COUNT];
+} Metrics;
+
+/* initMetrics: zero all the counters. */
+void initMetrics(Metrics *metrics);
+
+/* measureSource: scan a source and add its statistics to the metrics. */
+void measureSource(Metrics *metrics, const char *source);
+
+/* addMetrics: add the counters of other to metrics. */
+void addMetrics(Metrics *metrics, Metrics const *other);
+
+/* printMetrics: print metrics as one line of JSON.
+ *
+ * @kind: what the metrics are about, e.g. "file" or "tree".
+ * @path: the file or tree path.
+ */
+void printMetrics(FILE *file, const char *kind, const char *path,
+    Metrics const *metrics);
+
+#endif
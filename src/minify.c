@@ -0,0 +1,284 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "minify.h"
+#include "stream.h"
+
+#define MINIFY_SPACES 64
+
+/* the separators and indentation of minified sources. */
+static const char Spaces[MINIFY_SPACES + 1] =
+    "                "
+    "                "
+    "                "
+    "                ";
+
+void initMinifier(Minifier *minifier, bool drop_docstrings) {
+    minifier->drop_docstrings = drop_docstrings;
+    minifier->slices = NULL;
+    minifier->count = 0;
+    minifier->capacity = 0;
+    minifier->pair = NULL;
+    minifier->pair_capacity = 0;
+}
+
+void freeMinifier(Minifier *minifier) {
+    free(minifier->slices);
+    free(minifier->pair);
+    initMinifier(minifier, minifier->drop_docstrings);
+}
+
+/* add a slice, merging it with the last one if it follows it in memory. */
+static void addSlice(Minifier *minifier, const char *text, size_t length) {
+    if (length == 0)
+        return;
+
+    if (minifier->count > 0) {
+        struct iovec *last = &minifier->slices[minifier->count - 1];
+        if ((const char *)last->iov_base + last->iov_len == text) {
+            last->iov_len += length;
+            return;
+        }
+    }
+
+    if (minifier->count == minifier->capacity) {
+        minifier->capacity = minifier->capacity < 256
+            ? 256 : minifier->capacity * 2;
+        minifier->slices = realloc(minifier->slices,
+            minifier->capacity * sizeof(struct iovec));
+        if (!minifier->slices) {
+            fprintf(stderr, "error: not enough memory to minify.\n");
+            exit(74);
+        }
+    }
+    minifier->slices[minifier->count++] = (struct iovec) {
+        .iov_base = (void *)text,
+        .iov_len = length
+    };
+}
+
+/* indent the logical line starting with a token, with the indentation of
+ * the source when it already is one space per level. */
+static void addIndent(Minifier *minifier, Token token, int depth) {
+    if (token.column == depth && depth <= MINIFY_SPACES
+        && !memcmp(token.start - depth, Spaces, depth))
+    {
+        addSlice(minifier, token.start - depth, depth);
+        return;
+    }
+
+    for (; depth > MINIFY_SPACES; depth -= MINIFY_SPACES)
+        addSlice(minifier, Spaces, MINIFY_SPACES);
+    addSlice(minifier, Spaces, depth);
+}
+
+/* whether a comment line declares the encoding of the source. */
+static bool isCodingComment(const char *comment, const char *end) {
+    for (const char *p = comment; p + 6 < end; ++p) {
+        if (!strncmp(p, "coding", 6) && (p[6] == ':' || p[6] == '='))
+            return true;
+    }
+    return false;
+}
+
+/* keep the comments of the first two lines that are more than comments: a
+ * shebang, and the declaration of the encoding. */
+static void addHeaderComments(Minifier *minifier, const char *source) {
+    const char *line = source;
+    for (int i = 0; i < 2 && *line; ++i) {
+        const char *end = strchr(line, '\n');
+        end = end ? end + 1 : line + strlen(line);
+        const char *comment = line + strspn(line, " \t\f");
+        if (*comment != '#') {
+            // an encoding is only declared after blank or comment lines.
+            if (comment + strspn(comment, "\r\n") != end)
+                return;
+        } else if ((i == 0 && comment == line && comment[1] == '!')
+            || isCodingComment(comment, end))
+        {
+            addSlice(minifier, line, end - line);
+            if (end[-1] != '\n')
+                addSlice(minifier, "\n", 1);
+        }
+        line = end;
+    }
+}
+
+static bool isWordByte(char c) {
+    return isalnum((unsigned char)c) || c == '_' || (unsigned char)c >= 0x80;
+}
+
+/* whether a token never scans as part of the tokens next to it. */
+static bool standsApart(TokenType type) {
+    switch (type) {
+        case TOKEN_LPAR:
+        case TOKEN_RPAR:
+        case TOKEN_LSQB:
+        case TOKEN_RSQB:
+        case TOKEN_LBRACE:
+        case TOKEN_RBRACE:
+        case TOKEN_COMMA:
+        case TOKEN_SEMI:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* whether two tokens need a space between them to scan as they did. */
+static bool needsSpace(Minifier *minifier, Token previous, Token token) {
+    // tokens already together in the source stay so.
+    if (previous.start + previous.length == token.start)
+        return false;
+    if (standsApart(previous.type) || standsApart(token.type))
+        return false;
+    if (isWordByte(previous.start[previous.length - 1])
+        && isWordByte(token.start[0]))
+    {
+        return true;
+    }
+
+    // anything else, such as `1 .real`, `* *` or `"" ""`, is told by
+    // scanning the lexemes put together.
+    int length = previous.length + token.length;
+    if (length >= minifier->pair_capacity) {
+        minifier->pair_capacity = length + 1 < 64 ? 64 : 2 * (length + 1);
+        free(minifier->pair);
+        minifier->pair = malloc(minifier->pair_capacity);
+        if (!minifier->pair) {
+            fprintf(stderr, "error: not enough memory to minify.\n");
+            exit(74);
+        }
+    }
+    memcpy(minifier->pair, previous.start, previous.length);
+    memcpy(minifier->pair + previous.length, token.start, token.length);
+    minifier->pair[length] = '\0';
+
+    Scanner scanner;
+    initScanner(&scanner, minifier->pair);
+    Token first = scanToken(&scanner);
+    Token second = scanToken(&scanner);
+    return first.type != previous.type || first.length != previous.length
+        || second.type != token.type || second.length != token.length;
+}
+
+/* whether the string just taken from the stream starts a docstring that can
+ * be left out: a statement made only of strings, followed by another
+ * statement if it is the first of a block. prefixed strings, f-strings among
+ * them, scan as a NAME and a STRING and are never taken for docstrings. */
+static bool isDocstring(TokenStream *stream, bool is_block) {
+    size_t k = 0;
+    while (peekToken(stream, k).type == TOKEN_STRING)
+        ++k;
+    if (peekToken(stream, k).type != TOKEN_NEWLINE)
+        return false;
+    return !is_block || peekToken(stream, k + 1).type != TOKEN_DEDENT;
+}
+
+bool minifySource(Minifier *minifier, const char *source) {
+    TokenStream stream;
+    initTokenStream(&stream, source, PYTHON_LATEST);
+    minifier->count = 0;
+    addHeaderComments(minifier, source);
+
+    int depth = 0;
+    bool is_line_start = true;
+    // a docstring may start the module, or the block of a definition.
+    bool may_be_docstring = true;
+    bool is_definition = false;
+    bool is_after_definition = false;
+    Token previous = {0};
+    for (;;) {
+        Token token = nextToken(&stream);
+        switch (token.type) {
+            case TOKEN_ENDMARKER:
+                freeTokenStream(&stream);
+                return true;
+            case TOKEN_ERROR:
+                minifier->error = token;
+                freeTokenStream(&stream);
+                return false;
+            case TOKEN_INDENT:
+                ++depth;
+                may_be_docstring = is_after_definition;
+                is_after_definition = false;
+                continue;
+            case TOKEN_DEDENT:
+                --depth;
+                continue;
+            case TOKEN_NEWLINE:
+                if (token.length == 1 && token.start[0] == '\n')
+                    addSlice(minifier, token.start, 1);
+                else
+                    addSlice(minifier, "\n", 1);
+                is_line_start = true;
+                is_after_definition = is_definition;
+                continue;
+            default:
+                break;
+        }
+
+        if (is_line_start) {
+            bool is_docstring = may_be_docstring && minifier->drop_docstrings
+                && token.type == TOKEN_STRING
+                && isDocstring(&stream, depth > 0);
+            may_be_docstring = false;
+            is_after_definition = false;
+            if (is_docstring) {
+                while (nextToken(&stream).type != TOKEN_NEWLINE)
+                    continue;
+                continue;
+            }
+
+            is_definition = token.type == TOKEN_DEF
+                || token.type == TOKEN_CLASS
+                || (token.type == TOKEN_ASYNC
+                    && peekToken(&stream, 0).type == TOKEN_DEF);
+            addIndent(minifier, token, depth);
+            is_line_start = false;
+        } else if (needsSpace(minifier, previous, token)) {
+            // the space of the source is as good as any.
+            if (token.start[-1] == ' '
+                && token.start - 1 == previous.start + previous.length)
+            {
+                addSlice(minifier, token.start - 1, 1);
+            } else {
+                addSlice(minifier, Spaces, 1);
+            }
+        }
+
+        addSlice(minifier, token.start, token.length);
+        previous = token;
+    }
+}
+
+bool writeMinified(Minifier *minifier, int fd) {
+    struct iovec *slices = minifier->slices;
+    int count = minifier->count;
+    while (count > 0) {
+        int batch = count < MINIFY_IOVECS ? count : MINIFY_IOVECS;
+        ssize_t written = writev(fd, slices, batch);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+
+        // skip what was written, the last slice possibly in part.
+        while (count > 0 && (size_t)written >= slices->iov_len) {
+            written -= slices->iov_len;
+            ++slices;
+            --count;
+        }
+        if (written > 0) {
+            slices->iov_base = (char *)slices->iov_base + written;
+            slices->iov_len -= written;
+        }
+    }
+
+    minifier->count = 0;
+    return true;
+}
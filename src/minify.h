@@ -0,0 +1,59 @@
+#ifndef MINIFY_H
+#define MINIFY_H
+
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#include "scanner.h"
+
+/* number of slices written at once by writeMinified(). */
+#define MINIFY_IOVECS 1024
+
+/* Minifier: a source minified as slices of the source itself.
+ *
+ * tokens are kept as they are, separated by a space only where the source
+ * would tokenize differently without one, and each logical line is indented
+ * with one space per level. comments, blank lines and line continuations
+ * are dropped. no text is copied: the slices point into the source, or to
+ * constant separators, and slices that follow each other in the source are
+ * merged.
+ *
+ * @drop_docstrings: whether to leave out the docstrings of the module, its
+ *      classes and functions. a docstring alone in its block is kept.
+ * @slices: the minified source, in order.
+ * @count: number of slices.
+ * @capacity: number of slices that fit before growing.
+ * @pair, @pair_capacity: where two lexemes are put together to be scanned.
+ * @error: the error token that stopped minifySource(), if any.
+ */
+typedef struct {
+    bool drop_docstrings;
+    struct iovec *slices;
+    int count;
+    int capacity;
+    char *pair;
+    int pair_capacity;
+    Token error;
+} Minifier;
+
+/* initMinifier: initialize a minifier with no slices. */
+void initMinifier(Minifier *minifier, bool drop_docstrings);
+
+/* freeMinifier: free the memory held by a minifier. */
+void freeMinifier(Minifier *minifier);
+
+/* minifySource: minify a source into the slices of the minifier.
+ *
+ * the source must outlive the slices. returns false if the source has an
+ * error token, which is kept in error.
+ */
+bool minifySource(Minifier *minifier, const char *source);
+
+/* writeMinified: write the slices to a file descriptor with writev(), at
+ * most MINIFY_IOVECS at a time. the slices are used up.
+ *
+ * returns false on write errors.
+ */
+bool writeMinified(Minifier *minifier, int fd);
+
+#endif
@@ -0,0 +1,226 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "diff.h"
+#include "pytokenize.h"
+#include "scanner.h"
+
+/* TokenError: an error met while tokenizing.
+ *
+ * @index: index of the error token.
+ * @message: the error message.
+ */
+typedef struct {
+    size_t index;
+    const char *message;
+} TokenError;
+
+/* PyTokTokenizer: a scanner over its own copy of the source.
+ *
+ * @scanner: the scanner.
+ * @source: the NUL terminated copy of the source.
+ * @produced: number of tokens produced so far.
+ * @is_done: true once the end marker was produced.
+ * @errors: errors met so far, in token order.
+ */
+struct PyTokTokenizer {
+    Scanner scanner;
+    char *source;
+    size_t produced;
+    bool is_done;
+    size_t errors_count;
+    size_t errors_capacity;
+    TokenError *errors;
+};
+
+int32_t pytokAbiVersion(void) {
+    return PYTOK_ABI_VERSION;
+}
+
+static PyTokTokenizer *createTokenizer(const char *source, size_t length,
+    PythonVersion version)
+{
+    if (length > INT32_MAX)
+        return NULL;
+
+    PyTokTokenizer *tokenizer = malloc(sizeof(*tokenizer));
+    char *copy = malloc(length + 1);
+    if (!tokenizer || !copy) {
+        free(tokenizer);
+        free(copy);
+        return NULL;
+    }
+
+    memcpy(copy, source, length);
+    copy[length] = '\0';
+
+    initScannerVersion(&tokenizer->scanner, copy, version);
+    tokenizer->source = copy;
+    tokenizer->produced = 0;
+    tokenizer->is_done = false;
+    tokenizer->errors_count = 0;
+    tokenizer->errors_capacity = 0;
+    tokenizer->errors = NULL;
+    return tokenizer;
+}
+
+PyTokTokenizer *pytokCreate(const char *source, size_t length) {
+    return createTokenizer(source, length, PYTHON_LATEST);
+}
+
+PyTokTokenizer *pytokCreateVersion(const char *source, size_t length,
+    int32_t version)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%d.%d", (int)(version / 100),
+        (int)(version % 100));
+    for (int i = 0; i < PYTHON_VERSION_COUNT; ++i) {
+        if (!strcmp(name, Python_Version_Names[i]))
+            return createTokenizer(source, length, i);
+    }
+    return NULL;
+}
+
+void pytokDestroy(PyTokTokenizer *tokenizer) {
+    if (!tokenizer)
+        return;
+    free(tokenizer->errors);
+    free(tokenizer->source);
+    free(tokenizer);
+}
+
+size_t pytokMaxTokens(size_t length) {
+    // every token consumes at least one byte except dedents, which each
+    // match an earlier indent, and the final error and end marker.
+    return 2 * length + 2;
+}
+
+static void recordError(PyTokTokenizer *tokenizer, const char *message) {
+    if (tokenizer->errors_count == tokenizer->errors_capacity) {
+        size_t capacity = tokenizer->errors_capacity < 8
+            ? 8 : tokenizer->errors_capacity * 2;
+        TokenError *errors = realloc(tokenizer->errors,
+            capacity * sizeof(*errors));
+        if (!errors)
+            return;
+        tokenizer->errors = errors;
+        tokenizer->errors_capacity = capacity;
+    }
+
+    tokenizer->errors[tokenizer->errors_count++] = (TokenError) {
+        .index = tokenizer->produced,
+        .message = message
+    };
+}
+
+size_t pytokTokenize(PyTokTokenizer *tokenizer, size_t capacity,
+    int32_t *types, int32_t *offsets, int32_t *lengths,
+    int32_t *lines, int32_t *columns)
+{
+    Scanner *scanner = &tokenizer->scanner;
+    size_t count = 0;
+
+    while (count < capacity && !tokenizer->is_done) {
+        Token token = scanToken(scanner);
+
+        // an error whose message can't be kept is still produced, it just
+        // has no message.
+        if (token.type == TOKEN_ERROR)
+            recordError(tokenizer, token.start);
+
+        // the scanner bounds the lexeme in the source even for errors, whose
+        // token points to the message instead.
+        if (types)
+            types[count] = token.type;
+        if (offsets)
+            offsets[count] = (int32_t)(scanner->start - tokenizer->source);
+        if (lengths)
+            lengths[count] = (int32_t)(scanner->current - scanner->start);
+        if (lines)
+            lines[count] = token.line;
+        if (columns)
+            columns[count] = token.column;
+
+        ++count;
+        ++tokenizer->produced;
+        tokenizer->is_done = token.type == TOKEN_ENDMARKER;
+    }
+
+    return count;
+}
+
+const char *pytokErrorMessage(PyTokTokenizer const *tokenizer, size_t index) {
+    size_t low = 0, high = tokenizer->errors_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (tokenizer->errors[mid].index < index)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (low < tokenizer->errors_count && tokenizer->errors[low].index == index)
+        return tokenizer->errors[low].message;
+    return NULL;
+}
+
+static char *copySource(const char *source, size_t length) {
+    char *copy = length <= INT32_MAX ? malloc(length + 1) : NULL;
+    if (copy) {
+        memcpy(copy, source, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+int64_t pytokDiff(const char *old_source, size_t old_length,
+    const char *new_source, size_t new_length, size_t capacity,
+    int32_t *old_starts, int32_t *old_counts,
+    int32_t *new_starts, int32_t *new_counts)
+{
+    char *old_copy = copySource(old_source, old_length);
+    char *new_copy = copySource(new_source, new_length);
+    TokenSequence old_tokens, new_tokens;
+    TokenDiff diff;
+    initTokenSequence(&old_tokens);
+    initTokenSequence(&new_tokens);
+    initTokenDiff(&diff);
+
+    int64_t count = -1;
+    if (old_copy && new_copy && tokenizeSequence(&old_tokens, old_copy)
+        && tokenizeSequence(&new_tokens, new_copy))
+    {
+        count = diffTokens(&diff, &old_tokens, &new_tokens);
+    }
+
+    for (int64_t i = 0; i < count && (size_t)i < capacity; ++i) {
+        TokenEdit const *edit = &diff.edits[i];
+        if (old_starts)
+            old_starts[i] = edit->old_start;
+        if (old_counts)
+            old_counts[i] = edit->old_count;
+        if (new_starts)
+            new_starts[i] = edit->new_start;
+        if (new_counts)
+            new_counts[i] = edit->new_count;
+    }
+
+    freeTokenDiff(&diff);
+    freeTokenSequence(&old_tokens);
+    freeTokenSequence(&new_tokens);
+    free(old_copy);
+    free(new_copy);
+    return count;
+}
+
+int32_t pytokTokenTypeCount(void) {
+    return TOKEN_COUNT;
+}
+
+const char *pytokTokenName(int32_t type) {
+    if (type < 0 || type >= pytokTokenTypeCount())
+        return NULL;
+    return Token_Names[type];
+}
@@ -0,0 +1,134 @@
+#ifndef PYTOKENIZE_H
+#define PYTOKENIZE_H
+
+/* public interface of the pytokenize library.
+ *
+ * this is the only header of the shared library, and the only symbols it
+ * exports. everything in it keeps a stable C ABI: types are fixed size,
+ * tokenizers are opaque handles and tokens are written to caller-owned
+ * arrays, one array per field, so bindings can wrap them without copying
+ * (e.g. as NumPy or Arrow buffers). the ABI version is bumped on any
+ * incompatible change.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(PYTOK_BUILD) && defined(__GNUC__)
+#define PYTOK_API __attribute__((visibility("default")))
+#else
+#define PYTOK_API
+#endif
+
+#define PYTOK_ABI_VERSION 1
+
+/* PyTokTokenizer: an opaque tokenizer over a source buffer. */
+typedef struct PyTokTokenizer PyTokTokenizer;
+
+/* pytokAbiVersion: the ABI version the library was built with.
+ *
+ * bindings should check it against PYTOK_ABI_VERSION before any other call.
+ */
+PYTOK_API int32_t pytokAbiVersion(void);
+
+/* pytokCreate: create a tokenizer over a source buffer, with the keywords
+ * and operators of the latest python version supported.
+ *
+ * @source: the source bytes, they need not be NUL terminated and are copied,
+ *      so the buffer can be released after the call. scanning stops at the
+ *      first NUL byte if there is one.
+ * @length: length of source in bytes, at most INT32_MAX.
+ *
+ * returns NULL if out of memory or if the source is too long.
+ */
+PYTOK_API PyTokTokenizer *pytokCreate(const char *source, size_t length);
+
+/* pytokCreateVersion: create a tokenizer over a source buffer, with the
+ * keywords and operators of a given python version.
+ *
+ * @source, @length: as in pytokCreate().
+ * @version: the python version as major * 100 + minor, e.g. 311 for 3.11.
+ *      versions 3.6 to 3.13 are supported.
+ *
+ * returns NULL if out of memory, if the source is too long or if the
+ * version is not supported.
+ */
+PYTOK_API PyTokTokenizer *pytokCreateVersion(const char *source,
+    size_t length, int32_t version);
+
+/* pytokDestroy: free a tokenizer. */
+PYTOK_API void pytokDestroy(PyTokTokenizer *tokenizer);
+
+/* pytokMaxTokens: upper bound on the number of tokens of a source.
+ *
+ * arrays of this capacity are always large enough to tokenize a source of
+ * the given length in a single pytokTokenize() call.
+ */
+PYTOK_API size_t pytokMaxTokens(size_t length);
+
+/* pytokTokenize: tokenize into caller-owned arrays.
+ *
+ * write up to capacity tokens, continuing where the previous call stopped,
+ * and return the number written. the last token is the ENDMARKER, after
+ * which calls return 0. any of the arrays may be NULL to skip a field.
+ *
+ * @types: token types, see pytokTokenName().
+ * @offsets: byte offsets of the lexemes in the source.
+ * @lengths: byte lengths of the lexemes. for errors, the length of the
+ *      source consumed, see pytokErrorMessage() for the message.
+ * @lines: lines at which the lexemes start, counting from 1.
+ * @columns: columns at which the lexemes start, in bytes from 0.
+ */
+PYTOK_API size_t pytokTokenize(PyTokTokenizer *tokenizer, size_t capacity,
+    int32_t *types, int32_t *offsets, int32_t *lengths,
+    int32_t *lines, int32_t *columns);
+
+/* pytokErrorMessage: message of an error token.
+ *
+ * @index: index of the token among all the tokens produced so far.
+ *
+ * returns NULL if that token is not an error, or in the unlikely case that
+ * there was no memory left to keep its message.
+ */
+PYTOK_API const char *pytokErrorMessage(PyTokTokenizer const *tokenizer,
+    size_t index);
+
+/* pytokDiff: token-level differences between two sources.
+ *
+ * both sources are tokenized and their tokens compared by type and lexeme,
+ * so that changes to whitespace, comments, line breaks within brackets or
+ * the width of indents are not differences. each difference is an edit
+ * replacing old_counts[i] tokens of the old source, from index
+ * old_starts[i], by new_counts[i] tokens of the new source, from index
+ * new_starts[i], where indexes are those of pytokTokenize(). either count
+ * may be 0.
+ *
+ * @old_source, @old_length, @new_source, @new_length: the sources, as in
+ *      pytokCreate().
+ * @capacity: number of edits the arrays can hold. any of them may be NULL
+ *      to skip a field.
+ *
+ * returns the number of edits, 0 if the sources only differ in formatting,
+ * of which at most capacity are written, or -1 if out of memory or if a
+ * source is too long.
+ */
+PYTOK_API int64_t pytokDiff(const char *old_source, size_t old_length,
+    const char *new_source, size_t new_length, size_t capacity,
+    int32_t *old_starts, int32_t *old_counts,
+    int32_t *new_starts, int32_t *new_counts);
+
+/* pytokTokenTypeCount: number of token types. */
+PYTOK_API int32_t pytokTokenTypeCount(void);
+
+/* pytokTokenName: name of a token type, or NULL if out of range. */
+PYTOK_API const char *pytokTokenName(int32_t type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
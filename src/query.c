@@ -0,0 +1,425 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "query.h"
+
+/* printable bytes by decreasing frequency in python sources. any byte not
+ * listed is rarer than all of them. */
+static const char Common_Bytes[] =
+    " etsranio\nlcfd,_p'u.()mh\"g:b0=yxE-wT1k#vNSIA2C\\R[L]OP3FMDq4>5*86U`B9/"
+    "7jz+GHWV{}|%K<\rX@?Y~!;Z";
+
+static int byteRarity(unsigned char byte) {
+    const char *found = byte ? strchr(Common_Bytes, byte) : NULL;
+    return found ? found - Common_Bytes : (int)sizeof(Common_Bytes);
+}
+
+static bool queryError(Query *query, const char *message) {
+    query->error = message;
+    return false;
+}
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/* the type of a name, those of types without a lexeme, like <NEWLINE>,
+ * being written without the angle brackets. */
+static int typeNamed(const char *name) {
+    size_t length = strlen(name);
+    for (int type = 0; type < TOKEN_COUNT; ++type) {
+        const char *type_name = Token_Names[type];
+        if (type_name[0] == '<') {
+            if (strlen(type_name) == length + 2
+                && !strncmp(type_name + 1, name, length))
+            {
+                return type;
+            }
+        } else if (!strcmp(name, type_name)) {
+            return type;
+        }
+    }
+    return -1;
+}
+
+/* the type of the one token a lexeme is made of, or TOKEN_ERROR. */
+static TokenType lexemeType(const char *text, int length) {
+    Scanner scanner;
+    initScanner(&scanner, text);
+    Token token = scanToken(&scanner);
+
+    switch (token.type) {
+        case TOKEN_ERROR:
+        case TOKEN_ENDMARKER:
+        case TOKEN_NEWLINE:
+        case TOKEN_INDENT:
+        case TOKEN_DEDENT:
+            return TOKEN_ERROR;
+        default:
+            return token.start == text && token.length == length
+                ? token.type : TOKEN_ERROR;
+    }
+}
+
+static bool addStep(Query *query, QueryStep step) {
+    // runs of `...` are the same as one.
+    if (step.op == QUERY_SKIP && query->count > 0
+        && query->steps[query->count - 1].op == QUERY_SKIP)
+    {
+        return true;
+    }
+    if (query->count == QUERY_MAX_STEPS - 1)
+        return queryError(query, "too many steps");
+
+    query->steps[query->count++] = step;
+    return true;
+}
+
+static bool parseStep(Query *query, char **cursor) {
+    char *word = *cursor;
+    char *end;
+    bool is_quoted = *word == '\'' || *word == '"';
+    if (is_quoted) {
+        char quote = *word++;
+        end = strchr(word, quote);
+        if (!end)
+            return queryError(query, "unterminated quote");
+    } else {
+        for (end = word; *end && !isSpace(*end); ++end)
+            ;
+    }
+    *cursor = *end ? end + 1 : end;
+    *end = '\0';
+
+    int type = is_quoted ? -1 : typeNamed(word);
+    if (!is_quoted && !strcmp(word, "?"))
+        return addStep(query, (QueryStep) {.op = QUERY_ANY});
+    if (!is_quoted && !strcmp(word, "..."))
+        return addStep(query, (QueryStep) {.op = QUERY_SKIP});
+    if (type >= 0)
+        return addStep(query, (QueryStep) {.op = QUERY_TYPE, .type = type});
+
+    int length = end - word;
+    TokenType lexeme_type = lexemeType(word, length);
+    if (lexeme_type == TOKEN_ERROR)
+        return queryError(query, "a lexeme is not a single token");
+    return addStep(query, (QueryStep) {
+        .op = QUERY_TEXT,
+        .type = lexeme_type,
+        .text = word,
+        .length = length
+    });
+}
+
+/* pick the literal whose least common byte is the rarest, the longest on
+ * ties, for queryMayMatch(). */
+static void chooseRareLiteral(Query *query) {
+    int best = -1;
+    for (int i = 0; i < query->count; ++i) {
+        QueryStep const *step = &query->steps[i];
+        if (step->op != QUERY_TEXT)
+            continue;
+
+        int index = 0;
+        for (int j = 1; j < step->length; ++j) {
+            if (byteRarity(step->text[j]) > byteRarity(step->text[index]))
+                index = j;
+        }
+
+        int rarity = byteRarity(step->text[index]);
+        if (rarity > best || (rarity == best
+            && step->length > query->rare_length))
+        {
+            best = rarity;
+            query->rare = step->text;
+            query->rare_length = step->length;
+            query->rare_index = index;
+        }
+    }
+}
+
+bool compileQuery(Query *query, const char *pattern) {
+    *query = (Query) {0};
+    size_t length = strlen(pattern);
+    query->pattern = malloc(length + 1);
+    if (!query->pattern) {
+        fprintf(stderr, "error: not enough memory for the query.\n");
+        exit(74);
+    }
+    memcpy(query->pattern, pattern, length + 1);
+
+    char *cursor = query->pattern;
+    for (;;) {
+        while (isSpace(*cursor))
+            ++cursor;
+        if (!*cursor)
+            break;
+        if (!parseStep(query, &cursor))
+            return false;
+    }
+
+    // a leading or trailing `...` would only ever match no token.
+    if (query->count > 0 && query->steps[query->count - 1].op == QUERY_SKIP)
+        --query->count;
+    if (query->count > 0 && query->steps[0].op == QUERY_SKIP) {
+        --query->count;
+        memmove(query->steps, query->steps + 1,
+            query->count * sizeof(QueryStep));
+    }
+    if (query->count == 0)
+        return queryError(query, "empty pattern");
+
+    query->steps[query->count++] = (QueryStep) {.op = QUERY_ACCEPT};
+    chooseRareLiteral(query);
+
+    query->added = calloc(query->count * (QUERY_MAX_DEPTH + 1),
+        sizeof(unsigned));
+    if (!query->added) {
+        fprintf(stderr, "error: not enough memory for the query.\n");
+        exit(74);
+    }
+    return true;
+}
+
+void freeQuery(Query *query) {
+    free(query->pattern);
+    free(query->threads);
+    free(query->next);
+    free(query->matches);
+    free(query->added);
+    *query = (Query) {0};
+}
+
+bool queryMayMatch(Query const *query, const char *source, size_t length) {
+    if (!query->rare)
+        return true;
+
+    const char *end = source + length;
+    const char *cursor = source + query->rare_index;
+    char byte = query->rare[query->rare_index];
+    while (cursor < end && (cursor = memchr(cursor, byte, end - cursor))) {
+        const char *start = cursor - query->rare_index;
+        if (end - start >= query->rare_length
+            && !memcmp(start, query->rare, query->rare_length))
+        {
+            return true;
+        }
+        ++cursor;
+    }
+    return false;
+}
+
+/* start a new round, in which no partial match was added yet. */
+static void nextRound(Query *query) {
+    if (++query->round == 0) {
+        memset(query->added, 0,
+            query->count * (QUERY_MAX_DEPTH + 1) * sizeof(unsigned));
+        query->round = 1;
+    }
+}
+
+void startQuery(Query *query, const char *source) {
+    nextRound(query);
+    query->source = source;
+    query->threads_count = 0;
+    query->next_count = 0;
+    query->matches_count = 0;
+    query->held = 0;
+}
+
+/* add the match completed by a partial match. it is the shortest from its
+ * start, since the partial matches from there are dropped as it completes,
+ * and it replaces the matches held from that start or after, which overlap
+ * it. */
+static void holdMatch(Query *query, QueryThread const *thread,
+    const char *end)
+{
+    Token const *start = &thread->start;
+    int offset = (int)(start->start - query->source);
+    while (query->held > 0
+        && query->matches[query->matches_count - 1].offset >= offset)
+    {
+        --query->matches_count;
+        --query->held;
+    }
+
+    if (query->matches_count == query->matches_capacity) {
+        query->matches_capacity = query->matches_capacity < 8
+            ? 8 : query->matches_capacity * 2;
+        query->matches = realloc(query->matches,
+            query->matches_capacity * sizeof(QueryMatch));
+        if (!query->matches) {
+            fprintf(stderr, "error: not enough memory for query matches.\n");
+            exit(74);
+        }
+    }
+
+    query->matches[query->matches_count++] = (QueryMatch) {
+        .offset = offset,
+        .length = (int)(end - start->start),
+        .line = start->line,
+        .column = start->column
+    };
+    ++query->held;
+}
+
+static void reserveThreads(Query *query) {
+    if (query->next_count < query->threads_capacity)
+        return;
+
+    query->threads_capacity = query->threads_capacity < 16
+        ? 16 : query->threads_capacity * 2;
+    size_t size = query->threads_capacity * sizeof(QueryThread);
+    query->threads = realloc(query->threads, size);
+    query->next = realloc(query->next, size);
+    if (!query->threads || !query->next) {
+        fprintf(stderr, "error: not enough memory for the query.\n");
+        exit(74);
+    }
+}
+
+/* add a partial match to the next list, also moving past a `...` that
+ * matches no more tokens. a partial match at the same step and depth as one
+ * already in the list, which started earlier, is dropped since they would
+ * both end at the same tokens, and the earlier start wins. returns true if
+ * the match is complete, ending at end. */
+static bool addThread(Query *query, QueryThread thread, const char *end) {
+    QueryStep const *step = &query->steps[thread.step];
+    if (step->op == QUERY_ACCEPT) {
+        holdMatch(query, &thread, end);
+        return true;
+    }
+
+    unsigned *added =
+        &query->added[thread.step * (QUERY_MAX_DEPTH + 1) + thread.depth];
+    if (*added == query->round)
+        return false;
+    *added = query->round;
+
+    reserveThreads(query);
+    query->next[query->next_count++] = thread;
+    if (step->op == QUERY_SKIP && thread.depth == 0) {
+        thread.step++;
+        return addThread(query, thread, end);
+    }
+    return false;
+}
+
+/* advance a partial match over a token. */
+static bool stepThread(Query *query, QueryThread thread, Token token) {
+    QueryStep const *step = &query->steps[thread.step];
+    switch (step->op) {
+        case QUERY_TYPE:
+        case QUERY_TEXT:
+            if (token.type != step->type)
+                return false;
+            if (step->op == QUERY_TEXT && (token.length != step->length
+                || memcmp(token.start, step->text, step->length)))
+            {
+                return false;
+            }
+            thread.step++;
+            break;
+        case QUERY_ANY:
+            thread.step++;
+            break;
+        case QUERY_SKIP:
+            switch (token.type) {
+                case TOKEN_NEWLINE:
+                case TOKEN_INDENT:
+                case TOKEN_DEDENT:
+                    return false;
+                case TOKEN_LPAR:
+                case TOKEN_LSQB:
+                case TOKEN_LBRACE:
+                    if (thread.depth == QUERY_MAX_DEPTH)
+                        return false;
+                    thread.depth++;
+                    break;
+                case TOKEN_RPAR:
+                case TOKEN_RSQB:
+                case TOKEN_RBRACE:
+                    if (thread.depth == 0)
+                        return false;
+                    thread.depth--;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case QUERY_ACCEPT:
+            return false;
+    }
+
+    return addThread(query, thread, token.start + token.length);
+}
+
+void queryToken(Query *query, Token token) {
+    // matches do not span errors, whose text is not in the source.
+    if (token.type == TOKEN_ERROR || token.type == TOKEN_ENDMARKER) {
+        finishQuery(query);
+        return;
+    }
+
+    // partial matches are kept in the order they started, so a complete
+    // match overrides every partial match after it in the list.
+    nextRound(query);
+    query->next_count = 0;
+    bool is_matched = false;
+    for (int i = 0; i < query->threads_count && !is_matched; ++i)
+        is_matched = stepThread(query, query->threads[i], token);
+
+    if (is_matched) {
+        // partial matches from the start of the match on overlap it, or
+        // would only complete a longer one.
+        int offset = query->matches[query->matches_count - 1].offset;
+        while (query->next_count > 0
+            && query->next[query->next_count - 1].start.start - query->source
+                >= offset)
+        {
+            --query->next_count;
+        }
+    } else {
+        QueryThread thread = {.step = 0, .depth = 0, .start = token};
+        stepThread(query, thread, token);
+    }
+
+    QueryThread *threads = query->threads;
+    query->threads = query->next;
+    query->next = threads;
+    query->threads_count = query->next_count;
+
+    // a held match is final once no partial match started before it.
+    while (query->held > 0) {
+        QueryMatch const *match =
+            &query->matches[query->matches_count - query->held];
+        if (query->threads_count > 0
+            && query->threads[0].start.start - query->source <= match->offset)
+        {
+            break;
+        }
+        --query->held;
+    }
+}
+
+void finishQuery(Query *query) {
+    query->threads_count = 0;
+    query->held = 0;
+}
+
+int runQuery(Query *query, const char *source, size_t length) {
+    startQuery(query, source);
+    if (queryMayMatch(query, source, length)) {
+        Scanner scanner;
+        initScanner(&scanner, source);
+        Token token;
+        do {
+            token = scanToken(&scanner);
+            queryToken(query, token);
+        } while (token.type != TOKEN_ENDMARKER);
+    }
+
+    finishQuery(query);
+    return query->matches_count;
+}
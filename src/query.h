@@ -0,0 +1,158 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "scanner.h"
+
+#define QUERY_MAX_STEPS 64
+/* deepest brackets a `...` step skips over, as deep as python allows. */
+#define QUERY_MAX_DEPTH 200
+
+/* pattern language of queries.
+ *
+ * a pattern is a sequence of steps separated by spaces, each matching one
+ * token or a run of tokens:
+ *  - `NAME`, `NUMBER`, `LPAR`...: a token of the given type.
+ *  - `?`: any token.
+ *  - `...`: a run of zero or more tokens with balanced brackets, nested at
+ *      most QUERY_MAX_DEPTH deep, staying in one logical line.
+ *  - `'lexeme'`, `"lexeme"` or any other word: a token with exactly that
+ *      source text, such as `eval`, `(` or `'except'`. quotes are needed for
+ *      lexemes that would otherwise read as one of the above.
+ */
+
+typedef enum {
+    QUERY_TYPE,
+    QUERY_TEXT,
+    QUERY_ANY,
+    QUERY_SKIP,
+    QUERY_ACCEPT
+} QueryOp;
+
+/* QueryStep: one instruction of a compiled pattern.
+ *
+ * @op: what the step matches.
+ * @type: the token type for QUERY_TYPE and QUERY_TEXT steps.
+ * @text: the lexeme of QUERY_TEXT steps.
+ * @length: length of text.
+ */
+typedef struct {
+    QueryOp op;
+    TokenType type;
+    const char *text;
+    int length;
+} QueryStep;
+
+/* QueryThread: a partial match, waiting for the next token.
+ *
+ * @step: the step the next token has to match.
+ * @depth: bracket depth reached inside a `...` step.
+ * @start: the token the match started at.
+ */
+typedef struct {
+    int step;
+    int depth;
+    Token start;
+} QueryThread;
+
+/* QueryMatch: a match of a query.
+ *
+ * @offset: offset of the first token of the match in the source.
+ * @length: length of the source text matched.
+ * @line, @column: position of the first token.
+ */
+typedef struct {
+    int offset;
+    int length;
+    int line;
+    int column;
+} QueryMatch;
+
+/* Query: a compiled pattern and the state of a search with it.
+ *
+ * patterns compile to a nondeterministic automaton over tokens, run by
+ * keeping a list of the partial matches, so each token is looked at once.
+ * the list holds at most one partial match per step and `...` depth, the
+ * one that started first, so each token costs at most QUERY_MAX_STEPS
+ * times QUERY_MAX_DEPTH steps of the automaton.
+ * as with grep -o, matches do not overlap: the leftmost is found first,
+ * with the shortest run of tokens matching from there, and the search goes
+ * on after it.
+ *
+ * @error: why the pattern could not be compiled, or NULL.
+ * @pattern: copy of the pattern the lexemes of steps point into.
+ * @count: number of steps, the last being QUERY_ACCEPT.
+ * @steps: the compiled pattern.
+ * @rare, @rare_length: the literal text of the pattern least likely to
+ *      appear in a source, or NULL if there is none.
+ * @rare_index: index in rare of its least common byte.
+ * @source: the source being searched.
+ * @threads, @next: partial matches before and after the current token.
+ * @threads_count, @next_count: number of partial matches in the lists.
+ * @threads_capacity: number of partial matches that fit in each list.
+ * @added: for each step and `...` depth, the round a partial match at it
+ *      was last added to the next list in.
+ * @round: number of tokens fed, and of searches started, so far.
+ * @matches_count: number of matches found.
+ * @matches_capacity: number of matches that fit before growing.
+ * @matches: matches found, in source order.
+ * @held: number of matches, at the end of matches, that a partial match
+ *      started before them may still replace.
+ */
+typedef struct {
+    const char *error;
+    char *pattern;
+    int count;
+    QueryStep steps[QUERY_MAX_STEPS];
+    const char *rare;
+    int rare_length;
+    int rare_index;
+    const char *source;
+    QueryThread *threads;
+    QueryThread *next;
+    int threads_count;
+    int next_count;
+    int threads_capacity;
+    unsigned *added;
+    unsigned round;
+    int matches_count;
+    int matches_capacity;
+    QueryMatch *matches;
+    int held;
+} Query;
+
+/* compileQuery: compile a pattern.
+ *
+ * returns false if the pattern is invalid, with error set to the reason.
+ * the query must be freed either way.
+ */
+bool compileQuery(Query *query, const char *pattern);
+
+/* freeQuery: free the memory held by a query. */
+void freeQuery(Query *query);
+
+/* queryMayMatch: tell whether a source can match a query without scanning.
+ *
+ * looks for the rarest literal of the pattern with memchr() on its least
+ * common byte. false means the source cannot match.
+ */
+bool queryMayMatch(Query const *query, const char *source, size_t length);
+
+/* startQuery: start a search over a source, forgetting previous matches. */
+void startQuery(Query *query, const char *source);
+
+/* queryToken: feed the next token of the source to the search. */
+void queryToken(Query *query, Token token);
+
+/* finishQuery: end the search, keeping the matches held. */
+void finishQuery(Query *query);
+
+/* runQuery: search a whole source, returning the number of matches.
+ *
+ * the source is only scanned if queryMayMatch() is true.
+ */
+int runQuery(Query *query, const char *source, size_t length);
+
+#endif
@@ -9,6 +9,12 @@
 #define TAB_SIZE 8
 
 void initScanner(Scanner *scnr, const char *source) {
+    initScannerVersion(scnr, source, PYTHON_LATEST);
+}
+
+void initScannerVersion(Scanner *scnr, const char *source,
+    PythonVersion version)
+{
     scnr->start = source;
     scnr->current = source;
     scnr->start_line = 1;
@@ -21,6 +27,7 @@ void initScanner(Scanner *scnr, const char *source) {
     scnr->indent = 0;
     scnr->pending_dedents = 0;
     scnr->is_line_start = true;
+    scnr->grammar = &Grammars[version];
 }
 
 static Token makeToken(Scanner const *scnr, TokenType type) {
@@ -62,6 +69,33 @@ static char advance(Scanner *scnr) {
     return *scnr->current++;
 }
 
+/* advance the scanner up to end, as calling advance() for each character
+ * in between would. */
+static void advanceTo(Scanner *scnr, const char *end) {
+    const char *line_start = NULL;
+    const char *p = scnr->current;
+
+    while ((p = memchr(p, '\n', end - p))) {
+        ++scnr->current_line;
+        line_start = ++p;
+    }
+
+    if (line_start)
+        scnr->current_column = (int)(end - line_start);
+    else
+        scnr->current_column += (int)(end - scnr->current);
+
+    if (end > scnr->current)
+        scnr->is_line_start = end[-1] == '\n';
+    scnr->current = end;
+}
+
+/* find the end of the line p is on: its newline or the end of the source. */
+static const char *lineEnd(const char *p) {
+    const char *end = strchr(p, '\n');
+    return end ? end : p + strlen(p);
+}
+
 static bool isAtEnd(Scanner const *scnr) {
     return *scnr->current == '\0';
 }
@@ -110,8 +144,7 @@ static void skipWhitespace(Scanner *scnr) {
                 // don't consume newline
                 return;
             case '#':
-                while (!isAtEnd(scnr) && peek(scnr) != '\n')
-                    advance(scnr);
+                advanceTo(scnr, lineEnd(scnr->current));
                 return;
             default:
                 return;
@@ -119,91 +152,59 @@ static void skipWhitespace(Scanner *scnr) {
     }
 }
 
-static TokenType nameType(Scanner *scnr) {
-    int id_len = scnr->current - scnr->start;
-
-    #define IS_TOKEN(STRING)     \
-        id_len == strlen(STRING) \
-        && !memcmp(scnr->start, STRING, strlen(STRING))
-
-    if (IS_TOKEN("as")) {
-        return TOKEN_AS;
-    } else if (IS_TOKEN("and")) {
-        return TOKEN_AND;
-    } else if (IS_TOKEN("assert")) {
-        return TOKEN_ASSERT;
-    } else if (IS_TOKEN("break")) {
-        return TOKEN_BREAK;
-    } else if (IS_TOKEN("class")) {
-        return TOKEN_CLASS;
-    } else if (IS_TOKEN("continue")) {
-        return TOKEN_CONTINUE;
-    } else if (IS_TOKEN("def")) {
-        return TOKEN_DEF;
-    } else if (IS_TOKEN("del")) {
-        return TOKEN_DEL;
-    } else if (IS_TOKEN("elif")) {
-        return TOKEN_ELIF;
-    } else if (IS_TOKEN("else")) {
-        return TOKEN_ELSE;
-    } else if (IS_TOKEN("except")) {
-        return TOKEN_EXCEPT;
-    } else if (IS_TOKEN("False")) {
-        return TOKEN_FALSE;
-    } else if (IS_TOKEN("finally")) {
-        return TOKEN_FINALLY;
-    } else if (IS_TOKEN("for")) {
-        return TOKEN_FOR;
-    } else if (IS_TOKEN("from")) {
-        return TOKEN_FROM;
-    } else if (IS_TOKEN("global")) {
-        return TOKEN_GLOBAL;
-    } else if (IS_TOKEN("if")) {
-        return TOKEN_IF;
-    } else if (IS_TOKEN("import")) {
-        return TOKEN_IMPORT;
-    } else if (IS_TOKEN("in")) {
-        return TOKEN_IN;
-    } else if (IS_TOKEN("is")) {
-        return TOKEN_IS;
-    } else if (IS_TOKEN("lambda")) {
-        return TOKEN_LAMBDA;
-    } else if (IS_TOKEN("None")) {
-        return TOKEN_NONE;
-    } else if (IS_TOKEN("nonlocal")) {
-        return TOKEN_NONLOCAL;
-    } else if (IS_TOKEN("not")) {
-        return TOKEN_NOT;
-    } else if (IS_TOKEN("or")) {
-        return TOKEN_OR;
-    } else if (IS_TOKEN("pass")) {
-        return TOKEN_PASS;
-    } else if (IS_TOKEN("raise")) {
-        return TOKEN_RAISE;
-    } else if (IS_TOKEN("return")) {
-        return TOKEN_RETURN;
-    } else if (IS_TOKEN("True")) {
-        return TOKEN_TRUE;
-    } else if (IS_TOKEN("try")) {
-        return TOKEN_TRY;
-    } else if (IS_TOKEN("while")) {
-        return TOKEN_WHILE;
-    } else if (IS_TOKEN("with")) {
-        return TOKEN_WITH;
-    } else if (IS_TOKEN("yield")) {
-        return TOKEN_YIELD;
-    } else {
-        return TOKEN_NAME;
-    }
+static Token name(Scanner *scnr) {
+    const char *end = scnr->current;
+    while (isAlphanum(*end) || *end == '_')
+        ++end;
+    advanceTo(scnr, end);
 
-    #undef IS_TOKEN
+    return makeToken(scnr,
+        scnr->grammar->keyword(scnr->start, (int)(end - scnr->start)));
 }
 
-static Token name(Scanner *scnr) {
-    while (isAlphanum(peek(scnr)) || peek(scnr) == '_')
-        advance(scnr);
+/* find the end of a string literal body starting at p, as delimited by
+ * quote_char. sets is_terminated to false if the string is not terminated,
+ * in which case the end is the newline of a single-line string or the end
+ * of the source. */
+static const char *stringEnd(const char *p, char quote_char,
+    bool is_multiline, bool *is_terminated)
+{
+    // a backslash only matters before a newline, which a multiline string
+    // takes in anyway, so only the quotes of its body are looked at.
+    while (is_multiline) {
+        const char *quote = strchr(p, quote_char);
+        if (!quote) {
+            *is_terminated = false;
+            return p + strlen(p);
+        }
+        p = quote + 1;
+        if (p[0] == quote_char && p[1] == quote_char) {
+            *is_terminated = true;
+            return p + 2;
+        }
+    }
+
+    const char stops[] = {quote_char, '\\', '\n', '\0'};
+
+    for (;;) {
+        p += strcspn(p, stops);
 
-    return makeToken(scnr, nameType(scnr));
+        switch (*p) {
+            case '\0':
+            case '\n':
+                // don't consume newline character in an unterminated
+                // single-line string.
+                *is_terminated = false;
+                return p;
+            case '\\':
+                if (*++p == '\n')
+                    ++p;
+                break;
+            default:
+                *is_terminated = true;
+                return p + 1;
+        }
+    }
 }
 
 static Token string(Scanner *scnr) {
@@ -217,31 +218,68 @@ static Token string(Scanner *scnr) {
         is_multiline = true;
     }
 
-    for (;;) {
-        // don't consume newline character in an unterminated single-line string.
-        if (isAtEnd(scnr) || (!is_multiline && peek(scnr) == '\n'))
-            return errorToken(scnr, "unterminated string literal");
+    bool is_terminated;
+    advanceTo(scnr,
+        stringEnd(scnr->current, quote_char, is_multiline, &is_terminated));
 
-        char c = advance(scnr);
+    if (!is_terminated)
+        return errorToken(scnr, "unterminated string literal");
 
-        if (c == quote_char && is_multiline
-         && peek(scnr) == quote_char
-         && peekNext(scnr) == quote_char)
-        {
-            advance(scnr);
-            advance(scnr);
-            break;
-        } else if (c == quote_char && !is_multiline) {
+    return makeToken(scnr, TOKEN_STRING);
+}
+
+/* scan the longest operator at the current character, following the
+ * operator DFA of the grammar as far as it goes. */
+static Token operator(Scanner *scnr) {
+    Grammar const *grammar = scnr->grammar;
+    const char *p = scnr->current;
+    const char *end = p;
+    TokenType type = TOKEN_ERROR;
+
+    for (int state = 0;;) {
+        state = grammar->operator_next[state][
+            Operator_Classes[(unsigned char)*p]];
+        if (!state)
             break;
-        } else if (c == '\\') {
-            match(scnr, '\n');
+
+        ++p;
+        if (grammar->operator_accept[state] != TOKEN_ERROR) {
+            type = grammar->operator_accept[state];
+            end = p;
         }
     }
 
-    return makeToken(scnr, TOKEN_STRING);
+    if (type == TOKEN_ERROR) {
+        advance(scnr);
+        return errorToken(scnr, "unexpected character");
+    }
+
+    // operators never span lines.
+    scnr->current_column += (int)(end - scnr->current);
+    scnr->current = end;
+    scnr->is_line_start = false;
+
+    switch (type) {
+        case TOKEN_LPAR:
+        case TOKEN_LSQB:
+        case TOKEN_LBRACE:
+            ++scnr->level;
+            break;
+        case TOKEN_RPAR:
+        case TOKEN_RSQB:
+        case TOKEN_RBRACE:
+            --scnr->level;
+            break;
+        default:
+            break;
+    }
+
+    return makeToken(scnr, type);
 }
 
 static Token number(Scanner *scnr) {
+    bool has_point = false;
+
     if (match(scnr, '0')) {
         bool got_num = true;
         if (match(scnr, 'b') || match(scnr, 'B')) {
@@ -259,10 +297,10 @@ static Token number(Scanner *scnr) {
 
         if (got_num)
             return makeToken(scnr, TOKEN_NUMBER);
+    } else {
+        has_point = advance(scnr) == '.';
     }
 
-    bool has_point = advance(scnr) == '.';
-
     while (isdigit(peek(scnr)))
         advance(scnr);
 
@@ -292,17 +330,19 @@ static IndentState getIndentation(Scanner *scnr) {
 
     int spaces = 0;
     int altspaces = 0;
-    for (;;) {
-        if (match(scnr, ' ')) {
+    const char *end = scnr->current;
+    for (;; ++end) {
+        if (*end == ' ') {
             ++spaces;
             ++altspaces;
-        } else if (match(scnr, '\t')) {
+        } else if (*end == '\t') {
             spaces = (spaces / TAB_SIZE + 1) * TAB_SIZE;
             ++altspaces;
         } else {
             break;
         }
     }
+    advanceTo(scnr, end);
 
     // handle empty lines.
     if (isWhitespace(peek(scnr))) {
@@ -342,161 +382,164 @@ static IndentState getIndentation(Scanner *scnr) {
 }
 
 Token scanToken(Scanner *scnr) {
-    if (!scnr->is_line_start || scnr->level != 0) {
-        skipWhitespace(scnr);
-    }
-
-    markTokenStart(scnr);
+    // loop instead of recursing on insignificant newlines and line
+    // continuations, so stack depth stays constant regardless of input.
+    for (;;) {
+        if (!scnr->is_line_start || scnr->level != 0) {
+            skipWhitespace(scnr);
+        }
 
-    while ((scnr->is_line_start && scnr->level == 0) || isAtEnd(scnr)) {
-        IndentState state = getIndentation(scnr);
+        markTokenStart(scnr);
 
-        if (state == INDENT_INCREMENT) {
-            return makeToken(scnr, TOKEN_INDENT);
-        } else if (state == INDENT_DECREMENT) {
-            return makeToken(scnr, TOKEN_DEDENT);
-        } else if (state == INDENT_EXCEED) { 
-            return errorToken(scnr,
-                "indents exceeded the maximum indentation limit");
-        } else if (state == INDENT_ERROR) {
-            return errorToken(scnr, "indent error");
-        } else if (state == INDENT_NONE) {
-            markTokenStart(scnr);
-            break;
-        } else if (state == INDENT_EMPTY) {
-            // consume insignificant newline character if any.
-            match(scnr, '\n');
-            markTokenStart(scnr);
-            continue;
+        // pending dedents must drain before anything else on the line, even
+        // once the indentation whitespace has been consumed.
+        while ((scnr->is_line_start && scnr->level == 0)
+            || scnr->pending_dedents > 0 || isAtEnd(scnr))
+        {
+            IndentState state = getIndentation(scnr);
+
+            if (state == INDENT_INCREMENT) {
+                return makeToken(scnr, TOKEN_INDENT);
+            } else if (state == INDENT_DECREMENT) {
+                return makeToken(scnr, TOKEN_DEDENT);
+            } else if (state == INDENT_EXCEED) { 
+                return errorToken(scnr,
+                    "indents exceeded the maximum indentation limit");
+            } else if (state == INDENT_ERROR) {
+                return errorToken(scnr, "indent error");
+            } else if (state == INDENT_NONE) {
+                markTokenStart(scnr);
+                break;
+            } else if (state == INDENT_EMPTY) {
+                // consume insignificant newline character if any.
+                match(scnr, '\n');
+                markTokenStart(scnr);
+                continue;
+            }
         }
-    }
 
-    if (isAtEnd(scnr)) {
-        if (scnr->level != 0) {
-            // report error only once.
-            scnr->level = 0;
-            return errorToken(scnr, "EOF in multi-line statement");
-        } else {
-            return makeToken(scnr, TOKEN_ENDMARKER);
+        if (isAtEnd(scnr)) {
+            if (scnr->level != 0) {
+                // report error only once.
+                scnr->level = 0;
+                return errorToken(scnr, "EOF in multi-line statement");
+            } else {
+                return makeToken(scnr, TOKEN_ENDMARKER);
+            }
         }
-    }
 
-    if (match(scnr, '\n')) {
-        if (scnr->level != 0) {
-            return scanToken(scnr);
-        } else {
-            return makeToken(scnr, TOKEN_NEWLINE);
+        if (match(scnr, '\n')) {
+            if (scnr->level != 0) {
+                // newlines are insignificant inside brackets.
+                continue;
+            } else {
+                return makeToken(scnr, TOKEN_NEWLINE);
+            }
         }
-    }
 
-    char c = peek(scnr);
+        char c = peek(scnr);
 
-    if (isdigit(c) || (c == '.' && isdigit(peekNext(scnr))))
-        return number(scnr);
-    else if (isAlpha(c) || c == '_')
-        return name(scnr);
-    else if (c == '"' || c == '\'')
-        return string(scnr);
+        if (isdigit(c) || (c == '.' && isdigit(peekNext(scnr))))
+            return number(scnr);
+        else if (isAlpha(c) || c == '_')
+            return name(scnr);
+        else if (c == '"' || c == '\'')
+            return string(scnr);
 
-    advance(scnr);
-
-    switch (c) {
-        case '(':
-            ++scnr->level;
-            return makeToken(scnr, TOKEN_LPAR);
-        case ')':
-            --scnr->level;
-            return makeToken(scnr, TOKEN_RPAR);
-        case '{':
-            ++scnr->level;
-            return makeToken(scnr, TOKEN_LBRACE);
-        case '}':
-            --scnr->level;
-            return makeToken(scnr, TOKEN_RBRACE);
-        case '[':
-            ++scnr->level;
-            return makeToken(scnr, TOKEN_LSQB);
-        case ']':
-            --scnr->level;
-            return makeToken(scnr, TOKEN_RSQB);
-        case ':':
-            return makeToken(scnr, TOKEN_COLON);
-        case ';':
-            return makeToken(scnr, TOKEN_SEMI);
-        case ',':
-            return makeToken(scnr, TOKEN_COMMA);
-        case '.':
-            if (peek(scnr) == '.' && peekNext(scnr) == '.') {
-                advance(scnr);
-                advance(scnr);
-                return makeToken(scnr, TOKEN_ELLIPSIS);
-            } else {
-                return makeToken(scnr, TOKEN_DOT);
-            }
-        case '+':
-            return makeToken(scnr,
-                match(scnr, '=') ? TOKEN_PLUSEQUAL : TOKEN_PLUS);
-        case '-':
-            if (match(scnr, '>')) return makeToken(scnr, TOKEN_RARROW);
-            return makeToken(scnr,
-                match(scnr, '=') ? TOKEN_MINEQUAL : TOKEN_MINUS);
-        case '*': 
-            if (match(scnr, '*'))
-                return makeToken(scnr,
-                    match(scnr, '=') ? TOKEN_DOUBLESTAREQUAL : TOKEN_DOUBLESTAR);
-            else
-                return makeToken(scnr,
-                    match(scnr, '=') ? TOKEN_STAREQUAL : TOKEN_STAR);
-        case '/':
-            if (match(scnr, '/'))
-                return makeToken(scnr,
-                    match(scnr, '=') ? TOKEN_DOUBLESLASHEQUAL : TOKEN_DOUBLESLASH);
-            else
-                return makeToken(scnr,
-                    match(scnr, '=') ? TOKEN_SLASHEQUAL : TOKEN_SLASH);
-        case '@':
-            return makeToken(scnr,
-                match(scnr, '=') ? TOKEN_ATEQUAL : TOKEN_AT);
-        case '%':
-            return makeToken(scnr,
-                match(scnr, '=') ? TOKEN_PERCENTEQUAL : TOKEN_PERCENT);
-        case '|':
-            return makeToken(scnr,
-                match(scnr, '=') ? TOKEN_VBAREQUAL : TOKEN_VBAR);
-        case '&':
-            return makeToken(scnr,
-                match(scnr, '=') ? TOKEN_AMPER : TOKEN_AMPEREQUAL);
-        case '^':
-            return makeToken(scnr,
-                match(scnr, '=') ? TOKEN_CIRCUMFLEXEQUAL : TOKEN_CIRCUMFLEX);
-        case '=':
-            return makeToken(scnr,
-                match(scnr, '=') ? TOKEN_EQEQUAL : TOKEN_EQUAL);
-        case '<':
-            if (match(scnr, '<'))
-                return makeToken(scnr,
-                    match(scnr, '=') ? TOKEN_LEFTSHIFTEQUAL : TOKEN_LEFTSHIFT);
-            else
-                return makeToken(scnr,
-                    match(scnr, '=') ? TOKEN_LESSEQUAL : TOKEN_LESS);
-        case '>':
-            if (match(scnr, '>'))
-                return makeToken(scnr,
-                    match(scnr, '=') ? TOKEN_RIGHTSHIFTEQUAL : TOKEN_RIGHTSHIFT);
-            else
-                return makeToken(scnr,
-                    match(scnr, '=') ? TOKEN_GREATEREQUAL : TOKEN_GREATER);
-        case '!':
-            if (match(scnr, '='))
-                return makeToken(scnr, TOKEN_NOTEQUAL);
-        case '\\':
+        if (c == '\\') {
+            advance(scnr);
             if (match(scnr, '\n')) {
                 scnr->is_line_start = false;
-                return scanToken(scnr);
+                continue;
             }
             return errorToken(scnr,
                 "unexpected character after line continuation character");
+        }
+
+        return operator(scnr);
+    }
+}
+
+bool isSoftKeyword(Scanner const *scnr, Token token) {
+    return token.type == TOKEN_NAME
+        && scnr->grammar->is_soft_keyword(token.start, token.length);
+}
+
+/* characters skipStatement() has to stop at, everything else is skipped. */
+static const bool statement_stops[256] = {
+    ['\0'] = true, ['\n'] = true, [';'] = true, ['#'] = true, ['\\'] = true,
+    ['"'] = true, ['\''] = true
+};
+
+/* change of bracket level for each character, so skipStatement() can keep
+ * count without stopping at brackets. */
+static const signed char bracket_levels[256] = {
+    ['('] = 1, ['['] = 1, ['{'] = 1,
+    [')'] = -1, [']'] = -1, ['}'] = -1
+};
+
+void skipStatement(Scanner *scnr) {
+    const char *p = scnr->current;
+    bool is_line_start = scnr->is_line_start;
+
+    // mirrors scanToken() closely enough that the scanner ends up in the
+    // same state, but works on the raw pointer and settles line and column
+    // once at the end.
+    for (;;) {
+        const char *run = p;
+        int level = scnr->level;
+        while (!statement_stops[(unsigned char)*p])
+            level += bracket_levels[(unsigned char)*p++];
+        scnr->level = level;
+        if (p != run)
+            is_line_start = false;
+
+        char c = *p;
+        if (c == '\0' || ((c == '\n' || c == ';') && scnr->level == 0))
+            break;
+
+        is_line_start = false;
+        switch (c) {
+            case '\n':
+                ++p;
+                is_line_start = true;
+                break;
+            case ';':
+                ++p;
+                break;
+            case '#':
+                p = lineEnd(p);
+                break;
+            case '\\':
+                if (*++p == '\n')
+                    ++p;
+                break;
+            case '"':
+            case '\'': {
+                bool is_multiline = p[1] == c && p[2] == c;
+                bool is_terminated;
+                p = stringEnd(p + (is_multiline ? 3 : 1), c, is_multiline,
+                    &is_terminated);
+                break;
+            }
+        }
+    }
+
+    advanceTo(scnr, p);
+    scnr->is_line_start = is_line_start;
+}
+
+void skipBlankLines(Scanner *scnr) {
+    const char *p = scnr->current;
+
+    for (;;) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            ++p;
+        if (*p != '#')
+            break;
+        p = lineEnd(p);
     }
 
-    return errorToken(scnr, "unexpected character");
+    advanceTo(scnr, p);
+    scnr->is_line_start = false;
 }
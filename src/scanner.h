@@ -3,6 +3,9 @@
 
 #define MAX_INDENT 125
 
+#include <stdbool.h>
+
+#include "grammar.h"
 #include "token.h"
 
 /* Scanner: represents the scanner state.
@@ -15,6 +18,7 @@
  * @indent: last pushed indent index.
  * @pending_dedents: number of dedents pending to be emitted.
  * @is_line_start: true if at the line start otherwise false.
+ * @grammar: the lexical grammar of the python version being scanned.
  */
 typedef struct {
     const char *start;
@@ -29,6 +33,7 @@ typedef struct {
     int indent;
     int pending_dedents;
     bool is_line_start;
+    Grammar const *grammar;
 } Scanner;
 
 /* initScanner: initialize the global scanner.
@@ -40,10 +45,44 @@ typedef struct {
  */
 void initScanner(Scanner *scanner, const char *source);
 
+/* initScannerVersion: initialize the scanner for a given python version.
+ *
+ * same as initScanner(), which scans the latest version, but recognizes the
+ * keywords and operators of the given version instead.
+ */
+void initScannerVersion(Scanner *scanner, const char *source,
+    PythonVersion version);
+
 /* scanToken: scan a token and return it token.
  *
  * scan a token and return it. this alter's the inner state of the scanner.
  */
 Token scanToken(Scanner *scanner);
 
+/* isSoftKeyword: return true if a NAME token is a soft keyword.
+ *
+ * soft keywords, like match and case, are only keywords in some contexts,
+ * which the scanner cannot tell apart, so they are always scanned as NAME.
+ */
+bool isSoftKeyword(Scanner const *scanner, Token token);
+
+/* skipStatement: skip the rest of the current simple statement.
+ *
+ * advance the scanner up to the next semicolon or newline outside of
+ * brackets (or the end of the source) without producing tokens, keeping track
+ * of strings, comments, brackets and line continuations as scanToken() would.
+ * the terminating semicolon or newline is left for the next scanToken() call.
+ */
+void skipStatement(Scanner *scanner);
+
+/* skipBlankLines: skip line breaks, blank lines and comments.
+ *
+ * advance the scanner past any newlines, whitespace and comments up to the
+ * first token of the next statement, without tracking indentation: the next
+ * scanToken() call returns that token rather than INDENT or DEDENT tokens.
+ * only meaningful outside of brackets, for callers that do not need
+ * indentation at all.
+ */
+void skipBlankLines(Scanner *scanner);
+
 #endif
\ No newline at end of file
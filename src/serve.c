@@ -0,0 +1,781 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "scanner.h"
+#include "serve.h"
+
+#define CACHE_ENTRIES 4096
+/* descriptors kept out of the cache: the standard streams, the listener,
+ * the epoll and the signalfd, plus those a worker holds while serving a
+ * request. */
+#define RESERVED_FDS 16
+#define WORKER_FDS 4
+#define MIN_THREADS 4
+#define MAX_BACKOFF_MS 128
+#define SERVE_QUEUE_SIZE 256
+#define SERVE_EVENTS 64
+#define SOURCE_SEALS (F_SEAL_WRITE | F_SEAL_SHRINK)
+#define RESULT_SEALS (F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+
+/* CacheEntry: the result of a source seen before.
+ *
+ * @hash: hash of the source.
+ * @length: length of the source.
+ * @fd: sealed memfd holding the result followed by the source, or -1 if the
+ *      entry is empty.
+ * @count: number of tokens.
+ * @size: size of the result, where the source starts.
+ */
+typedef struct {
+    uint64_t hash;
+    uint64_t length;
+    int fd;
+    uint32_t count;
+    uint64_t size;
+} CacheEntry;
+
+/* results are cached by source hash in a direct-mapped table, a new result
+ * replacing whatever was in its slot. each entry keeps a memfd open, so the
+ * table is sized by cacheEntries() to fit the descriptor limit. */
+static CacheEntry *cache;
+static size_t cache_entries;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Server: the connections of the daemon. one thread waits for requests on
+ * all of them and queues each connection with a request waiting, for the
+ * workers to serve that one request.
+ *
+ * @epoll: the listener, the signalfd and the connections. a connection is
+ *      armed for one request at a time, and armed again once it is served.
+ * @lock: guards the queue.
+ * @not_empty, @not_full: signaled as connections are queued and taken.
+ * @queue: a ring of queued connections, starting at first.
+ * @is_done: set when the daemon stops, once the queue is empty.
+ */
+typedef struct {
+    int epoll;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    int queue[SERVE_QUEUE_SIZE];
+    int first;
+    int queued;
+    bool is_done;
+} Server;
+
+/* Worker: a thread serving requests, with buffers reused across them.
+ *
+ * @server: the server requests are taken from.
+ * @tokens: room for five arrays of capacity int32_t.
+ * @capacity: number of tokens the arrays can hold.
+ * @messages: error messages of the tokens.
+ * @messages_size: size of the error messages.
+ * @messages_capacity: size the messages buffer can hold.
+ */
+typedef struct {
+    Server *server;
+    int32_t *tokens;
+    size_t capacity;
+    char *messages;
+    size_t messages_size;
+    size_t messages_capacity;
+} Worker;
+
+static uint64_t sourceHash(const char *source, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)source[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* number of cache entries that fit the descriptor limit, raised toward
+ * what a full cache needs if allowed. half of the descriptors left once the
+ * workers are served go to the cache, the rest to connections. */
+static size_t cacheEntries(int threads) {
+    rlim_t reserved = RESERVED_FDS + (rlim_t)WORKER_FDS * threads;
+    rlim_t wanted = reserved + 2 * CACHE_ENTRIES;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) < 0)
+        return 0;
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted) {
+        struct rlimit raised = limit;
+        raised.rlim_cur = limit.rlim_max != RLIM_INFINITY
+            && limit.rlim_max < wanted ? limit.rlim_max : wanted;
+        if (!setrlimit(RLIMIT_NOFILE, &raised))
+            limit = raised;
+    }
+
+    if (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur >= wanted)
+        return CACHE_ENTRIES;
+    return limit.rlim_cur > reserved ? (limit.rlim_cur - reserved) / 2 : 0;
+}
+
+/* whether a result memfd ends with a given source. */
+static bool holdsSource(int fd, uint64_t size, const char *source,
+    uint64_t length)
+{
+    // the memfd is sealed, so the mapping cannot fault or change.
+    char *map = mmap(NULL, size + length, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return false;
+    bool is_same = !memcmp(map + size, source, length);
+    munmap(map, size + length);
+    return is_same;
+}
+
+/* return a dup of the cached result of a source, or -1. */
+static int findResult(uint64_t hash, const char *source, uint64_t length,
+    ServeResponse *response)
+{
+    if (!cache_entries)
+        return -1;
+
+    CacheEntry *entry = &cache[hash % cache_entries];
+    int fd = -1;
+
+    // the entry may be replaced and its fd closed as soon as the lock is
+    // released, so hand out a dup of it.
+    pthread_mutex_lock(&cache_lock);
+    if (entry->fd >= 0 && entry->hash == hash && entry->length == length) {
+        fd = fcntl(entry->fd, F_DUPFD_CLOEXEC, 0);
+        response->count = entry->count;
+        response->size = entry->size;
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    // hashes are easy to collide on purpose, so a hit is only taken once
+    // the source kept with the result is the same.
+    if (fd >= 0 && !holdsSource(fd, response->size, source, length)) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static void cacheResult(uint64_t hash, uint64_t length, int fd,
+    ServeResponse const *response)
+{
+    if (!cache_entries)
+        return;
+
+    CacheEntry *entry = &cache[hash % cache_entries];
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0)
+        return;
+
+    pthread_mutex_lock(&cache_lock);
+    int old = entry->fd;
+    *entry = (CacheEntry) {
+        .hash = hash,
+        .length = length,
+        .fd = copy,
+        .count = response->count,
+        .size = response->size
+    };
+    pthread_mutex_unlock(&cache_lock);
+
+    if (old >= 0)
+        close(old);
+}
+
+static bool reserveTokens(Worker *worker, size_t count) {
+    if (count <= worker->capacity)
+        return true;
+
+    int32_t *tokens = realloc(worker->tokens, 5 * count * sizeof(int32_t));
+    if (!tokens)
+        return false;
+    worker->tokens = tokens;
+    worker->capacity = count;
+    return true;
+}
+
+static bool addMessage(Worker *worker, const char *message, size_t length) {
+    size_t size = worker->messages_size + length + 1;
+    if (size > worker->messages_capacity) {
+        size_t capacity = worker->messages_capacity < 256
+            ? 256 : worker->messages_capacity;
+        while (capacity < size)
+            capacity *= 2;
+        char *messages = realloc(worker->messages, capacity);
+        if (!messages)
+            return false;
+        worker->messages = messages;
+        worker->messages_capacity = capacity;
+    }
+
+    memcpy(worker->messages + worker->messages_size, message, length);
+    worker->messages[size - 1] = '\0';
+    worker->messages_size = size;
+    return true;
+}
+
+/* tokenize a NUL terminated source into a new sealed memfd, returning the
+ * memfd or -1 with errno set. the source is kept after the result, for
+ * findResult() to check cache hits against. */
+static int createResult(Worker *worker, const char *source, size_t length,
+    ServeResponse *response)
+{
+    // a source has at most 2 * length + 2 tokens, so the arrays never need
+    // to grow while scanning.
+    if (!reserveTokens(worker, 2 * length + 2)) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    size_t capacity = worker->capacity;
+    int32_t *types = worker->tokens;
+    int32_t *offsets = types + capacity;
+    int32_t *lengths = offsets + capacity;
+    int32_t *lines = lengths + capacity;
+    int32_t *columns = lines + capacity;
+    worker->messages_size = 0;
+
+    Scanner scanner;
+    initScanner(&scanner, source);
+    uint32_t count = 0;
+    for (;;) {
+        Token token = scanToken(&scanner);
+        types[count] = token.type;
+        offsets[count] = (int32_t)(scanner.start - source);
+        lengths[count] = (int32_t)(scanner.current - scanner.start);
+        lines[count] = token.line;
+        columns[count] = token.column;
+        ++count;
+
+        if (token.type == TOKEN_ERROR
+            && !addMessage(worker, token.start, token.length))
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+        if (token.type == TOKEN_ENDMARKER)
+            break;
+    }
+
+    ServeResultHeader header = {
+        .magic = SERVE_RESULT_MAGIC,
+        .count = count,
+        .messages_size = (uint32_t)worker->messages_size
+    };
+    size_t array_size = count * sizeof(int32_t);
+    struct iovec parts[] = {
+        {&header, sizeof(header)},
+        {types, array_size},
+        {offsets, array_size},
+        {lengths, array_size},
+        {lines, array_size},
+        {columns, array_size},
+        {worker->messages, worker->messages_size},
+        {(void *)source, length}
+    };
+    size_t size = sizeof(header) + 5 * array_size + worker->messages_size;
+
+    int fd = memfd_create("pytokenize-result", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0)
+        return -1;
+
+    ssize_t written = writev(fd, parts, sizeof(parts) / sizeof(*parts));
+    if (written != (ssize_t)(size + length)
+        || fcntl(fd, F_ADD_SEALS, RESULT_SEALS) < 0)
+    {
+        if (written >= 0 && written != (ssize_t)(size + length))
+            errno = EIO;
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+
+    response->count = count;
+    response->size = size;
+    return fd;
+}
+
+/* answer with the result of a NUL terminated source, from the cache if it
+ * was seen before. returns the result memfd or -1 with errno set. */
+static int resultOf(Worker *worker, const char *source, size_t length,
+    ServeResponse *response)
+{
+    uint64_t hash = sourceHash(source, length);
+    int fd = findResult(hash, source, length, response);
+    if (fd >= 0)
+        return fd;
+
+    fd = createResult(worker, source, length, response);
+    if (fd >= 0)
+        cacheResult(hash, length, fd, response);
+    return fd;
+}
+
+static int readPath(Worker *worker, const char *path, ServeResponse *response)
+{
+    int file = open(path, O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return -1;
+
+    struct stat st;
+    int error = fstat(file, &st) < 0 ? errno
+        : S_ISDIR(st.st_mode) ? EISDIR
+        : !S_ISREG(st.st_mode) ? EINVAL
+        : st.st_size > INT32_MAX ? EFBIG : 0;
+    if (error) {
+        close(file);
+        errno = error;
+        return -1;
+    }
+
+    char *source = malloc(st.st_size + 1);
+    size_t length = 0;
+    ssize_t n = 0;
+    while (source && length < (size_t)st.st_size
+        && (n = read(file, source + length, st.st_size - length)) > 0)
+    {
+        length += n;
+    }
+    error = !source ? ENOMEM : n < 0 ? errno : 0;
+    close(file);
+
+    int fd = -1;
+    if (!error) {
+        source[length] = '\0';
+        fd = resultOf(worker, source, length, response);
+        error = errno;
+    }
+
+    free(source);
+    errno = error;
+    return fd;
+}
+
+static int readMemfd(Worker *worker, int source_fd, uint64_t length,
+    ServeResponse *response)
+{
+    struct stat st;
+    if (fstat(source_fd, &st) < 0)
+        return -1;
+    if (length > INT32_MAX || (uint64_t)st.st_size < length) {
+        errno = length > INT32_MAX ? EFBIG : EINVAL;
+        return -1;
+    }
+
+    // a source sealed against writes and shrinking, ending with a NUL byte,
+    // cannot change under the scanner and is tokenized in place.
+    int seals = fcntl(source_fd, F_GET_SEALS);
+    if (seals >= 0 && (seals & SOURCE_SEALS) == SOURCE_SEALS
+        && (uint64_t)st.st_size > length)
+    {
+        char *map = mmap(NULL, length + 1, PROT_READ, MAP_SHARED, source_fd,
+            0);
+        if (map == MAP_FAILED)
+            return -1;
+
+        int fd = -1;
+        bool is_terminated = map[length] == '\0';
+        if (is_terminated)
+            fd = resultOf(worker, map, length, response);
+        int error = errno;
+        munmap(map, length + 1);
+        errno = error;
+        if (is_terminated)
+            return fd;
+    }
+
+    // any other is read into a copy: a mapping would fault on the pages of
+    // a memfd the client truncates meanwhile.
+    char *source = malloc(length + 1);
+    if (!source) {
+        errno = ENOMEM;
+        return -1;
+    }
+    size_t done = 0;
+    ssize_t n = 0;
+    while (done < length
+        && (n = pread(source_fd, source + done, length - done, done)) > 0)
+    {
+        done += n;
+    }
+
+    int fd = -1;
+    int error = n < 0 ? errno : done < length ? EINVAL : 0;
+    if (!error) {
+        source[length] = '\0';
+        fd = resultOf(worker, source, length, response);
+        error = errno;
+    }
+
+    free(source);
+    errno = error;
+    return fd;
+}
+
+static bool sendResponse(int connection, ServeResponse const *response,
+    int fd)
+{
+    struct iovec iov = {(void *)response, sizeof(*response)};
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr message = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1
+    };
+
+    if (fd >= 0) {
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    return sendmsg(connection, &message, MSG_NOSIGNAL) == (ssize_t)sizeof(*response);
+}
+
+/* serve the request waiting on a connection. returns false once the client
+ * closed the connection or it failed. */
+static bool serveRequest(Worker *worker, int connection) {
+    struct {
+        ServeRequest request;
+        char path[PATH_MAX];
+    } buffer;
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    struct iovec iov = {&buffer, sizeof(buffer)};
+    struct msghdr message = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer)
+    };
+    ssize_t size = recvmsg(connection, &message,
+        MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (size < 0)
+        return errno == EAGAIN || errno == EINTR;
+    if (size == 0)
+        return false;
+
+    int source_fd = -1;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET
+        && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+        memcpy(&source_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    ServeRequest const *request = &buffer.request;
+    ServeResponse response = {0};
+    int fd = -1;
+    errno = EINVAL;
+    if ((size_t)size < sizeof(*request)
+        || (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+        || request->version != SERVE_VERSION)
+    {
+        // malformed request, errno is already set.
+    } else if (request->kind == SERVE_PATH
+        && request->length == size - sizeof(*request)
+        && request->length < PATH_MAX)
+    {
+        buffer.path[request->length] = '\0';
+        fd = readPath(worker, buffer.path, &response);
+    } else if (request->kind == SERVE_MEMFD && source_fd >= 0) {
+        fd = readMemfd(worker, source_fd, request->length, &response);
+    }
+
+    if (fd < 0)
+        response = (ServeResponse) {.status = errno ? errno : EIO};
+    if (source_fd >= 0)
+        close(source_fd);
+
+    bool is_sent = sendResponse(connection, &response, fd);
+    if (fd >= 0)
+        close(fd);
+    return is_sent;
+}
+
+/* watch a connection for its next request, adding it to the epoll with
+ * EPOLL_CTL_ADD or arming it again with EPOLL_CTL_MOD. */
+static bool watchConnection(Server *server, int connection, int operation) {
+    struct epoll_event event = {
+        .events = EPOLLIN | EPOLLONESHOT,
+        .data = {.fd = connection}
+    };
+    return epoll_ctl(server->epoll, operation, connection, &event) == 0;
+}
+
+/* queue a connection with a request waiting, waiting for the workers if the
+ * queue is full. */
+static void queueConnection(Server *server, int connection) {
+    pthread_mutex_lock(&server->lock);
+    while (server->queued == SERVE_QUEUE_SIZE)
+        pthread_cond_wait(&server->not_full, &server->lock);
+    int last = (server->first + server->queued) % SERVE_QUEUE_SIZE;
+    server->queue[last] = connection;
+    ++server->queued;
+    pthread_cond_signal(&server->not_empty);
+    pthread_mutex_unlock(&server->lock);
+}
+
+/* take a queued connection, or return -1 once the daemon stops. */
+static int takeConnection(Server *server) {
+    int connection = -1;
+    pthread_mutex_lock(&server->lock);
+    while (server->queued == 0 && !server->is_done)
+        pthread_cond_wait(&server->not_empty, &server->lock);
+    if (server->queued > 0) {
+        connection = server->queue[server->first];
+        server->first = (server->first + 1) % SERVE_QUEUE_SIZE;
+        --server->queued;
+        pthread_cond_signal(&server->not_full);
+    }
+    pthread_mutex_unlock(&server->lock);
+    return connection;
+}
+
+static void *runWorker(void *data) {
+    Worker *worker = data;
+    Server *server = worker->server;
+
+    int connection;
+    while ((connection = takeConnection(server)) >= 0) {
+        // closing the connection also takes it out of the epoll.
+        if (!serveRequest(worker, connection)
+            || !watchConnection(server, connection, EPOLL_CTL_MOD))
+        {
+            close(connection);
+        }
+    }
+
+    free(worker->tokens);
+    free(worker->messages);
+    return NULL;
+}
+
+/* accept the connections waiting on the listener. returns 0 once there are
+ * none left, otherwise the errno value accept4() failed with. */
+static int acceptConnections(Server *server, int listener) {
+    for (;;) {
+        int connection = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : errno;
+        }
+        if (!watchConnection(server, connection, EPOLL_CTL_ADD))
+            close(connection);
+    }
+}
+
+static long nowMs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000L + now.tv_nsec / 1000000L;
+}
+
+/* watch the listener for the given events, none while it is paused. */
+static void armListener(Server *server, int listener, uint32_t events) {
+    struct epoll_event event = {.events = events, .data = {.fd = listener}};
+    epoll_ctl(server->epoll, EPOLL_CTL_MOD, listener, &event);
+}
+
+/* wait for requests and queue them until a signal stops the daemon.
+ * returns false if accepting connections failed for good. */
+static bool pollConnections(Server *server, int listener, int signals) {
+    struct epoll_event events[SERVE_EVENTS];
+    long backoff = 0;
+    long resume = 0;
+    for (;;) {
+        // while out of descriptors, the listener is left alone for a while,
+        // longer each time, instead of spinning on accept4().
+        int timeout = -1;
+        if (resume) {
+            long now = nowMs();
+            timeout = resume > now ? (int)(resume - now) : 0;
+        }
+        int count = epoll_wait(server->epoll, events, SERVE_EVENTS, timeout);
+        if (count < 0 && errno != EINTR)
+            return false;
+
+        if (resume && nowMs() >= resume) {
+            armListener(server, listener, EPOLLIN);
+            resume = 0;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == signals) {
+                // take the signal, which would otherwise stay pending.
+                struct signalfd_siginfo info;
+                while (read(signals, &info, sizeof(info)) < 0
+                    && errno == EINTR)
+                {
+                    continue;
+                }
+                return true;
+            }
+            if (fd != listener) {
+                queueConnection(server, fd);
+                continue;
+            }
+
+            int error = acceptConnections(server, listener);
+            if (!error) {
+                backoff = 0;
+            } else if (error == EMFILE || error == ENFILE
+                || error == ENOBUFS || error == ENOMEM)
+            {
+                backoff = backoff ? backoff * 2 : 1;
+                if (backoff > MAX_BACKOFF_MS)
+                    backoff = MAX_BACKOFF_MS;
+                resume = nowMs() + backoff;
+                armListener(server, listener, 0);
+            } else {
+                errno = error;
+                return false;
+            }
+        }
+    }
+}
+
+/* add a descriptor to the epoll, waiting for it to be readable. */
+static bool watchReadable(Server *server, int fd) {
+    struct epoll_event event = {.events = EPOLLIN, .data = {.fd = fd}};
+    return epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+static void freeCache(void) {
+    for (size_t i = 0; i < cache_entries; ++i) {
+        if (cache[i].fd >= 0)
+            close(cache[i].fd);
+    }
+    free(cache);
+    cache = NULL;
+    cache_entries = 0;
+}
+
+int serve(const char *socket_path, int threads) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "error: socket path \"%s\" is too long.\n",
+            socket_path);
+        return 1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > MIN_THREADS ? (int)cpus : MIN_THREADS;
+    }
+
+    cache_entries = cacheEntries(threads);
+    cache = calloc(cache_entries ? cache_entries : 1, sizeof(CacheEntry));
+    Worker *workers = calloc(threads, sizeof(Worker));
+    pthread_t *handles = malloc(threads * sizeof(pthread_t));
+    if (!cache || !workers || !handles) {
+        fprintf(stderr, "error: not enough memory to serve.\n");
+        exit(74);
+    }
+    for (size_t i = 0; i < cache_entries; ++i)
+        cache[i].fd = -1;
+
+    // the signals that stop the daemon are read from a signalfd, so are
+    // blocked before any worker starts.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigset_t old_signals;
+    pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+
+    Server server = {0};
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.not_empty, NULL);
+    pthread_cond_init(&server.not_full, NULL);
+    int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK
+        | SOCK_CLOEXEC, 0);
+    int signal_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+    server.epoll = epoll_create1(EPOLL_CLOEXEC);
+    unlink(socket_path);
+    int status = 0;
+    if (listener < 0 || signal_fd < 0 || server.epoll < 0
+        || bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0
+        || listen(listener, SOMAXCONN) < 0
+        || !watchReadable(&server, listener)
+        || !watchReadable(&server, signal_fd))
+    {
+        fprintf(stderr, "error: could not listen on \"%s\": %s.\n",
+            socket_path, strerror(errno));
+        status = 1;
+    }
+
+    int started = 0;
+    for (; status == 0 && started < threads; ++started) {
+        workers[started].server = &server;
+        if (pthread_create(&handles[started], NULL, runWorker,
+            &workers[started]))
+        {
+            fprintf(stderr, "error: could not start serving threads.\n");
+            status = 1;
+            break;
+        }
+    }
+
+    if (status == 0 && !pollConnections(&server, listener, signal_fd)) {
+        fprintf(stderr, "error: could not accept connections: %s.\n",
+            strerror(errno));
+        status = 1;
+    }
+    unlink(socket_path);
+
+    // the workers finish the requests queued, then stop. connections still
+    // open are left to close with the process.
+    pthread_mutex_lock(&server.lock);
+    server.is_done = true;
+    pthread_cond_broadcast(&server.not_empty);
+    pthread_mutex_unlock(&server.lock);
+    for (int i = 0; i < started; ++i)
+        pthread_join(handles[i], NULL);
+
+    pthread_cond_destroy(&server.not_full);
+    pthread_cond_destroy(&server.not_empty);
+    pthread_mutex_destroy(&server.lock);
+    if (server.epoll >= 0)
+        close(server.epoll);
+    if (signal_fd >= 0)
+        close(signal_fd);
+    if (listener >= 0)
+        close(listener);
+    freeCache();
+    free(handles);
+    free(workers);
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    return status;
+}
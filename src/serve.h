@@ -0,0 +1,83 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stdint.h>
+
+/* protocol of the tokenization daemon.
+ *
+ * clients connect to a SOCK_SEQPACKET unix socket and send one ServeRequest
+ * per message, followed by the path to tokenize for SERVE_PATH requests, or
+ * passing a memfd holding the source for SERVE_MEMFD requests. the daemon
+ * answers each request with a ServeResponse message passing a read-only
+ * memfd with the tokens, laid out as a ServeResultHeader followed by the
+ * types, offsets, lengths, lines and columns of the tokens, each an array of
+ * count int32_t as in pytokTokenize(), and by the message of each error
+ * token, NUL terminated, in token order. the memfd goes on past the size of
+ * the response with a copy of the source, which the daemon checks cache
+ * hits against.
+ */
+
+#define SERVE_VERSION 1
+#define SERVE_RESULT_MAGIC "PTSR"
+
+typedef enum {
+    SERVE_PATH = 1,
+    SERVE_MEMFD = 2
+} ServeKind;
+
+/* ServeRequest: a tokenization request.
+ *
+ * @version: SERVE_VERSION.
+ * @kind: a ServeKind.
+ * @length: length of the path that follows, or of the source in the memfd.
+ *      a source memfd sealed against writes and shrinking, and ending with
+ *      a NUL byte after length bytes, is tokenized in place. any other is
+ *      copied with pread().
+ */
+typedef struct {
+    uint32_t version;
+    uint32_t kind;
+    uint64_t length;
+} ServeRequest;
+
+/* ServeResponse: the answer to a request.
+ *
+ * @status: 0 on success, otherwise an errno value and no memfd is passed.
+ * @count: number of tokens.
+ * @size: size of the result in the memfd.
+ */
+typedef struct {
+    uint32_t status;
+    uint32_t count;
+    uint64_t size;
+} ServeResponse;
+
+/* ServeResultHeader: the start of a result memfd.
+ *
+ * @magic: SERVE_RESULT_MAGIC.
+ * @count: number of tokens.
+ * @messages_size: size of the error messages after the token arrays.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t count;
+    uint32_t messages_size;
+    uint32_t reserved;
+} ServeResultHeader;
+
+/* serve: run the daemon on a unix socket until SIGINT or SIGTERM.
+ *
+ * any number of connections may stay open. one thread waits for requests on
+ * all of them, and hands each request to a pool of workers, so idle clients
+ * do not hold a worker. the signals are blocked in the calling thread while
+ * serving, and read from a signalfd.
+ *
+ * @socket_path: path of the socket, replaced if it exists.
+ * @threads: number of requests served at once, or 0 for one per processor
+ *      and at least 4.
+ *
+ * returns 0 on a clean exit, otherwise prints an error and returns 1.
+ */
+int serve(const char *socket_path, int threads);
+
+#endif
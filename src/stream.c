@@ -0,0 +1,102 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stream.h"
+
+static Token *allocateTokens(size_t capacity) {
+    Token *tokens = malloc(capacity * sizeof(Token));
+    if (!tokens) {
+        fprintf(stderr, "error: not enough memory for the token stream.\n");
+        exit(74);
+    }
+    return tokens;
+}
+
+void initTokenStream(TokenStream *stream, const char *source,
+    PythonVersion version)
+{
+    initScannerVersion(&stream->scanner, source, version);
+    stream->capacity = TOKEN_STREAM_CAPACITY;
+    stream->tokens = allocateTokens(stream->capacity);
+    stream->first = 0;
+    stream->position = 0;
+    stream->end = 0;
+    stream->marks = 0;
+    stream->pinned = 0;
+    stream->is_done = false;
+}
+
+void freeTokenStream(TokenStream *stream) {
+    free(stream->tokens);
+    stream->tokens = NULL;
+    stream->capacity = 0;
+}
+
+/* double the ring, moving each token to its slot in the larger one. */
+static void growStream(TokenStream *stream) {
+    size_t capacity = stream->capacity * 2;
+    Token *tokens = allocateTokens(capacity);
+    for (size_t i = stream->first; i < stream->end; ++i) {
+        tokens[i & (capacity - 1)] =
+            stream->tokens[i & (stream->capacity - 1)];
+    }
+
+    free(stream->tokens);
+    stream->tokens = tokens;
+    stream->capacity = capacity;
+}
+
+/* scan ahead until the token at index is in the ring or the source ends. */
+static void fillStream(TokenStream *stream, size_t index) {
+    while (stream->end <= index && !stream->is_done) {
+        // only tokens a mark can go back to are kept behind the position.
+        stream->first = stream->marks ? stream->pinned : stream->position;
+
+        size_t room = stream->capacity - (stream->end - stream->first);
+        if (room == 0) {
+            growStream(stream);
+            continue;
+        }
+
+        size_t batch = room < TOKEN_STREAM_BATCH ? room : TOKEN_STREAM_BATCH;
+        size_t mask = stream->capacity - 1;
+        for (size_t i = 0; i < batch && !stream->is_done; ++i) {
+            Token token = scanToken(&stream->scanner);
+            stream->tokens[stream->end++ & mask] = token;
+            stream->is_done = token.type == TOKEN_ENDMARKER;
+        }
+    }
+}
+
+Token peekToken(TokenStream *stream, size_t k) {
+    size_t index = stream->position + k;
+    fillStream(stream, index);
+    if (index >= stream->end)
+        index = stream->end - 1;
+    return stream->tokens[index & (stream->capacity - 1)];
+}
+
+Token nextToken(TokenStream *stream) {
+    Token token = peekToken(stream, 0);
+    if (token.type != TOKEN_ENDMARKER)
+        ++stream->position;
+    return token;
+}
+
+size_t markStream(TokenStream *stream) {
+    if (stream->marks++ == 0)
+        stream->pinned = stream->position;
+    return stream->position;
+}
+
+void resetStream(TokenStream *stream, size_t mark) {
+    // tokens before first may have been overwritten already.
+    assert(stream->first <= mark && mark <= stream->end);
+    stream->position = mark;
+}
+
+void releaseMark(TokenStream *stream) {
+    assert(stream->marks > 0);
+    --stream->marks;
+}
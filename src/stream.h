@@ -0,0 +1,84 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "scanner.h"
+
+/* initial number of tokens held by a stream, a power of two. */
+#define TOKEN_STREAM_CAPACITY 64
+
+/* number of tokens scanned ahead at once. */
+#define TOKEN_STREAM_BATCH 16
+
+/* TokenStream: a scanner with any number of tokens of lookahead.
+ *
+ * tokens are scanned ahead in batches into a ring buffer, and each byte of
+ * the source is scanned once however far ahead or back the parser looks.
+ * tokens behind the current one are dropped unless a mark holds them, so
+ * the ring only grows when the lookahead or a mark needs more room than it
+ * has, and never while parsing goes on at a steady depth.
+ *
+ * @scanner: the underlying scanner.
+ * @tokens: the ring of scanned tokens.
+ * @capacity: number of tokens the ring holds, a power of two.
+ * @first: index in the stream of the oldest token in the ring.
+ * @position: index in the stream of the next token to return.
+ * @end: index in the stream of the next token to scan.
+ * @marks: number of marks not released.
+ * @pinned: position of the oldest mark, kept in the ring while marks > 0.
+ * @is_done: true once the end marker was scanned.
+ */
+typedef struct {
+    Scanner scanner;
+    Token *tokens;
+    size_t capacity;
+    size_t first;
+    size_t position;
+    size_t end;
+    int marks;
+    size_t pinned;
+    bool is_done;
+} TokenStream;
+
+/* initTokenStream: initialize a stream over a source.
+ *
+ * @source: the source string to tokenize.
+ * @version: the python version to scan.
+ */
+void initTokenStream(TokenStream *stream, const char *source,
+    PythonVersion version);
+
+/* freeTokenStream: free the memory held by a stream. */
+void freeTokenStream(TokenStream *stream);
+
+/* peekToken: return the token k places after the next one, without
+ * consuming anything. peekToken(stream, 0) is the next token, and peeking
+ * past the end gives the end marker.
+ */
+Token peekToken(TokenStream *stream, size_t k);
+
+/* nextToken: consume and return the next token, the end marker once the
+ * stream is exhausted.
+ */
+Token nextToken(TokenStream *stream);
+
+/* markStream: mark the current position to come back to it with
+ * resetStream().
+ *
+ * the tokens from the oldest mark on are kept until every mark is released
+ * with releaseMark(), marks being released in the reverse order they were
+ * taken.
+ */
+size_t markStream(TokenStream *stream);
+
+/* resetStream: go back, or forward, to a marked position. the mark must
+ * still be held, its tokens being dropped once released.
+ */
+void resetStream(TokenStream *stream, size_t mark);
+
+/* releaseMark: release the last mark taken, one being held. */
+void releaseMark(TokenStream *stream);
+
+#endif
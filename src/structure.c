@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "structure.h"
+
+static void *growStructureArray(void *array, int *capacity, size_t item_size) {
+    *capacity = *capacity < 8 ? 8 : *capacity * 2;
+    array = realloc(array, *capacity * item_size);
+    if (!array) {
+        fprintf(stderr, "error: not enough memory for the structure index.\n");
+        exit(74);
+    }
+    return array;
+}
+
+void initStructureIndex(StructureIndex *index) {
+    index->count = 0;
+    index->capacity = 0;
+    index->matches = NULL;
+    index->lines_count = 0;
+    index->lines_capacity = 0;
+    index->lines = NULL;
+    index->mismatches_count = 0;
+    index->mismatches_capacity = 0;
+    index->mismatches = NULL;
+    index->depth = 0;
+    index->stack_capacity = 0;
+    index->stack = NULL;
+    index->is_line_start = true;
+}
+
+void freeStructureIndex(StructureIndex *index) {
+    free(index->matches);
+    free(index->lines);
+    free(index->mismatches);
+    free(index->stack);
+    initStructureIndex(index);
+}
+
+static TokenType closingType(TokenType type) {
+    switch (type) {
+        case TOKEN_LPAR: return TOKEN_RPAR;
+        case TOKEN_LSQB: return TOKEN_RSQB;
+        case TOKEN_LBRACE: return TOKEN_RBRACE;
+        case TOKEN_INDENT: return TOKEN_DEDENT;
+        default: return TOKEN_ERROR;
+    }
+}
+
+static void addMismatch(StructureIndex *index, Opening const *open,
+    int close, Token const *token)
+{
+    if (index->mismatches_count == index->mismatches_capacity) {
+        index->mismatches = growStructureArray(index->mismatches,
+            &index->mismatches_capacity, sizeof(Mismatch));
+    }
+
+    Mismatch *mismatch = &index->mismatches[index->mismatches_count++];
+    *mismatch = (Mismatch) { .open = -1, .close = -1 };
+    if (open) {
+        mismatch->open = open->index;
+        mismatch->open_type = open->type;
+        mismatch->open_line = open->line;
+        mismatch->open_column = open->column;
+    }
+    if (token) {
+        mismatch->close = close;
+        mismatch->close_type = token->type;
+        mismatch->close_line = token->line;
+        mismatch->close_column = token->column;
+    }
+}
+
+/* report the brackets left open inside the innermost block. */
+static void closeBrackets(StructureIndex *index) {
+    while (index->depth > 0
+        && index->stack[index->depth - 1].type != TOKEN_INDENT)
+    {
+        addMismatch(index, &index->stack[--index->depth], -1, NULL);
+    }
+}
+
+static void closeToken(StructureIndex *index, Token const *token) {
+    int close = index->count;
+
+    if (token->type == TOKEN_DEDENT)
+        closeBrackets(index);
+
+    // a closing bracket never closes a block, so a stray one leaves the
+    // stack alone. a bracket of the wrong kind closes the one open anyway.
+    Opening *open = index->depth > 0 ? &index->stack[index->depth - 1] : NULL;
+    bool is_block = token->type == TOKEN_DEDENT;
+    if (!open || (open->type == TOKEN_INDENT) != is_block) {
+        addMismatch(index, NULL, close, token);
+        return;
+    }
+
+    --index->depth;
+    if (closingType(open->type) != token->type) {
+        addMismatch(index, open, close, token);
+        return;
+    }
+
+    index->matches[open->index] = close;
+    index->matches[close] = open->index;
+}
+
+void indexStructure(StructureIndex *index, Token token) {
+    if (index->count == index->capacity) {
+        index->matches = growStructureArray(index->matches, &index->capacity,
+            sizeof(int));
+    }
+    index->matches[index->count] = -1;
+
+    switch (token.type) {
+        case TOKEN_LPAR:
+        case TOKEN_LSQB:
+        case TOKEN_LBRACE:
+        case TOKEN_INDENT:
+            if (index->depth == index->stack_capacity) {
+                index->stack = growStructureArray(index->stack,
+                    &index->stack_capacity, sizeof(Opening));
+            }
+            index->stack[index->depth++] = (Opening) {
+                .index = index->count,
+                .type = token.type,
+                .line = token.line,
+                .column = token.column
+            };
+            break;
+        case TOKEN_RPAR:
+        case TOKEN_RSQB:
+        case TOKEN_RBRACE:
+        case TOKEN_DEDENT:
+            closeToken(index, &token);
+            break;
+        case TOKEN_ENDMARKER:
+            closeBrackets(index);
+            break;
+        default:
+            break;
+    }
+
+    if (token.type == TOKEN_NEWLINE) {
+        index->is_line_start = true;
+    } else if (index->is_line_start && token.type != TOKEN_INDENT
+        && token.type != TOKEN_DEDENT && token.type != TOKEN_ENDMARKER)
+    {
+        if (index->lines_count == index->lines_capacity) {
+            index->lines = growStructureArray(index->lines, &index->lines_capacity,
+                sizeof(int));
+        }
+        index->lines[index->lines_count++] = index->count;
+        index->is_line_start = false;
+    }
+
+    ++index->count;
+}
@@ -0,0 +1,83 @@
+#ifndef STRUCTURE_H
+#define STRUCTURE_H
+
+#include <stdbool.h>
+
+#include "scanner.h"
+
+/* Mismatch: a bracket without a matching one.
+ *
+ * @open: token index of the opening bracket, or -1 for a closing bracket
+ *      with no opening bracket.
+ * @close: token index of the closing bracket, or -1 for an opening bracket
+ *      left open at the end of its block or of the source.
+ * @open_type, @open_line, @open_column: the opening bracket, if any.
+ * @close_type, @close_line, @close_column: the closing bracket, if any.
+ */
+typedef struct {
+    int open;
+    int close;
+    TokenType open_type;
+    int open_line;
+    int open_column;
+    TokenType close_type;
+    int close_line;
+    int close_column;
+} Mismatch;
+
+/* Opening: a bracket or INDENT not closed yet.
+ *
+ * @index: token index.
+ * @type, @line, @column: the token.
+ */
+typedef struct {
+    int index;
+    TokenType type;
+    int line;
+    int column;
+} Opening;
+
+/* StructureIndex: the nesting structure of a token stream.
+ *
+ * @count: number of tokens indexed.
+ * @matches: for each token, the index of the token closing it for opening
+ *      brackets and INDENT, the index of the token it closes for closing
+ *      brackets and DEDENT, or -1.
+ * @lines_count: number of logical lines.
+ * @lines: token index of the first token of each logical line, not counting
+ *      INDENT and DEDENT.
+ * @mismatches_count: number of mismatched brackets.
+ * @mismatches: the mismatched brackets, in order of detection.
+ * @stack: the brackets and INDENTs still open, innermost last.
+ * @is_line_start: true if the next token starts a logical line.
+ */
+typedef struct {
+    int count;
+    int capacity;
+    int *matches;
+    int lines_count;
+    int lines_capacity;
+    int *lines;
+    int mismatches_count;
+    int mismatches_capacity;
+    Mismatch *mismatches;
+    int depth;
+    int stack_capacity;
+    Opening *stack;
+    bool is_line_start;
+} StructureIndex;
+
+/* initStructureIndex: initialize an empty index. */
+void initStructureIndex(StructureIndex *index);
+
+/* freeStructureIndex: free the memory held by an index. */
+void freeStructureIndex(StructureIndex *index);
+
+/* indexStructure: add the next token of a stream to the index.
+ *
+ * call this for each token returned by a scanner, ENDMARKER included, to
+ * build the index during the scan.
+ */
+void indexStructure(StructureIndex *index, Token token);
+
+#endif
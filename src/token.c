@@ -97,4 +97,5 @@ const char * const Token_Names[] = {
     "WHILE",
     "WITH",
     "YIELD",
-};
\ No newline at end of file
+    "COLONEQUAL",
+};
@@ -1,7 +1,7 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
-/* AUTO-GENERATED DO NOT MODIFY. */
+/* AUTO-GENERATED DO NOT MODIFY. see tools/generate_tokens.py. */
 typedef enum {
     TOKEN_LPAR,
     TOKEN_RPAR,
@@ -95,6 +95,8 @@ typedef enum {
     TOKEN_WHILE,
     TOKEN_WITH,
     TOKEN_YIELD,
+    TOKEN_COLONEQUAL,
+    TOKEN_COUNT
 } TokenType;
 
 /* Token: represents a token.
@@ -115,4 +117,4 @@ typedef struct {
 /* table of token names */
 extern const char * const Token_Names[];
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trivia.h"
+
+const char *Trivia_Names[] = {
+    "<WHITESPACE>", "<COMMENT>", "<NL>", "<CONTINUATION>", "<ERRORTEXT>"
+};
+
+void initTriviaScanner(TriviaScanner *scanner, const char *source) {
+    initScanner(&scanner->scanner, source);
+    scanner->table.source = source;
+    scanner->table.count = 0;
+    scanner->table.capacity = 0;
+    scanner->table.trivia = NULL;
+    scanner->tokens = 0;
+}
+
+void freeTriviaScanner(TriviaScanner *scanner) {
+    free(scanner->table.trivia);
+    scanner->table.trivia = NULL;
+    scanner->table.count = 0;
+    scanner->table.capacity = 0;
+}
+
+static void addTrivia(TriviaScanner *scanner, TriviaType type,
+    const char *start, const char *end)
+{
+    TriviaTable *table = &scanner->table;
+    if (table->count == table->capacity) {
+        table->capacity = table->capacity < 8 ? 8 : table->capacity * 2;
+        table->trivia = realloc(table->trivia,
+            table->capacity * sizeof(Trivia));
+        if (!table->trivia) {
+            fprintf(stderr, "error: not enough memory for the trivia table.\n");
+            exit(74);
+        }
+    }
+
+    table->trivia[table->count++] = (Trivia) {
+        .type = type,
+        .token = scanner->tokens,
+        .offset = (int)(start - table->source),
+        .length = (int)(end - start)
+    };
+}
+
+/* split the text skipped by the scanner before a token into runs. the
+ * scanner only skips blanks, comments and newlines, with or without a
+ * backslash before them. */
+static void splitGap(TriviaScanner *scanner, const char *p, const char *end) {
+    while (p < end) {
+        const char *start = p;
+        TriviaType type;
+
+        if (*p == '#') {
+            const char *newline = memchr(p, '\n', end - p);
+            p = newline ? newline : end;
+            type = TRIVIA_COMMENT;
+        } else if (*p == '\n') {
+            ++p;
+            type = TRIVIA_NL;
+        } else if (*p == '\\') {
+            p += 2;
+            type = TRIVIA_CONTINUATION;
+        } else {
+            do {
+                ++p;
+            } while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'));
+            type = TRIVIA_WHITESPACE;
+        }
+
+        addTrivia(scanner, type, start, p);
+    }
+}
+
+Token scanTrivia(TriviaScanner *scanner) {
+    Scanner *scnr = &scanner->scanner;
+    const char *gap = scnr->current;
+
+    Token token = scanToken(scnr);
+    splitGap(scanner, gap, scnr->start);
+    if (token.type == TOKEN_ERROR && scnr->current > scnr->start)
+        addTrivia(scanner, TRIVIA_ERROR, scnr->start, scnr->current);
+
+    ++scanner->tokens;
+    return token;
+}
+
+int findTrivia(TriviaTable const *table, int token) {
+    int low = 0;
+    int high = table->count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (table->trivia[middle].token < token)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
@@ -0,0 +1,78 @@
+#ifndef TRIVIA_H
+#define TRIVIA_H
+
+#include "scanner.h"
+
+typedef enum {
+    TRIVIA_WHITESPACE,
+    TRIVIA_COMMENT,
+    TRIVIA_NL,              // newline that does not end a logical line
+    TRIVIA_CONTINUATION,    // backslash followed by a newline
+    TRIVIA_ERROR            // source text of an error token
+} TriviaType;
+
+extern const char *Trivia_Names[];
+
+/* Trivia: a run of source text that is not part of a token.
+ *
+ * @type: the type of the run.
+ * @token: index of the token the run precedes, or for TRIVIA_ERROR the
+ *      index of the error token itself.
+ * @offset: offset of the run in the source.
+ * @length: length of the run.
+ */
+typedef struct {
+    TriviaType type;
+    int token;
+    int offset;
+    int length;
+} Trivia;
+
+/* TriviaTable: the trivia of a source, ordered by offset.
+ *
+ * @source: the source string.
+ * @count: number of trivia in the table.
+ * @capacity: number of trivia the table can hold without growing.
+ * @trivia: the trivia.
+ */
+typedef struct {
+    const char *source;
+    int count;
+    int capacity;
+    Trivia *trivia;
+} TriviaTable;
+
+/* TriviaScanner: a scanner that keeps what the scanner skips.
+ *
+ * the tokens are the same as the underlying scanner's. the text between
+ * them goes into the trivia table, so that the source can be rebuilt from
+ * the tokens and the table. the error message replaces the text of an
+ * error token, so that text is kept as trivia as well.
+ *
+ * @scanner: the underlying scanner.
+ * @table: the trivia of the tokens scanned so far.
+ * @tokens: number of tokens scanned so far.
+ */
+typedef struct {
+    Scanner scanner;
+    TriviaTable table;
+    int tokens;
+} TriviaScanner;
+
+/* initTriviaScanner: initialize a trivia scanner with an empty table.
+ *
+ * @source: the source string to tokenize.
+ */
+void initTriviaScanner(TriviaScanner *scanner, const char *source);
+
+/* freeTriviaScanner: free the trivia table. */
+void freeTriviaScanner(TriviaScanner *scanner);
+
+/* scanTrivia: scan the next token, recording the trivia before it. */
+Token scanTrivia(TriviaScanner *scanner);
+
+/* findTrivia: return the index of the first trivia of a token in the
+ * table, or of the first trivia of a later token if it has none. */
+int findTrivia(TriviaTable const *table, int token);
+
+#endif
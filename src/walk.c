@@ -0,0 +1,113 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "archive.h"
+#include "walk.h"
+
+bool isPythonFile(const char *name) {
+    size_t len = strlen(name);
+    return len > 3 && !strcmp(name + len - 3, ".py");
+}
+
+char *readFile(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "error: could not open file \"%s\".\n", path);
+        return NULL;
+    }
+
+    fseek(file, 0L, SEEK_END);
+    size_t size = ftell(file);
+    rewind(file);
+
+    char *source = malloc(size + 1);
+    if (!source) {
+        fprintf(stderr, "error: not enough memory to read \"%s\".\n", path);
+        exit(74);
+    }
+
+    if (fread(source, 1, size, file) == size) {
+        source[size] = '\0';
+    } else {
+        fprintf(stderr, "error: could not read file \"%s\".\n", path);
+        free(source);
+        source = NULL;
+    }
+
+    fclose(file);
+    return source;
+}
+
+static void visitFile(const char *path, VisitFunc visit, void *data) {
+    char *source = readFile(path);
+    if (source)
+        visit(path, source, data);
+    free(source);
+}
+
+static void walkDirectory(const char *path, VisitFunc visit, void *data) {
+    struct dirent **entries;
+    int count = scandir(path, &entries, NULL, alphasort);
+    if (count < 0) {
+        fprintf(stderr, "error: could not open directory \"%s\".\n", path);
+        return;
+    }
+
+    size_t path_len = strlen(path);
+    for (int i = 0; i < count; ++i) {
+        const char *name = entries[i]->d_name;
+        if (name[0] == '.') {
+            free(entries[i]);
+            continue;
+        }
+
+        char *child = malloc(path_len + strlen(name) + 2);
+        if (!child) {
+            fprintf(stderr, "error: not enough memory to walk \"%s\".\n", path);
+            exit(74);
+        }
+        sprintf(child, "%s/%s", path, name);
+
+        // links to files are read, but links to directories are not
+        // followed, so that a walk never loops.
+        struct stat st;
+        bool is_found = lstat(child, &st) == 0;
+        bool is_link = is_found && S_ISLNK(st.st_mode);
+        if (is_link)
+            is_found = stat(child, &st) == 0;
+        if (is_found) {
+            if (S_ISDIR(st.st_mode) && !is_link)
+                walkDirectory(child, visit, data);
+            else if (S_ISREG(st.st_mode) && isPythonFile(name))
+                visitFile(child, visit, data);
+            else if (S_ISREG(st.st_mode) && isArchive(name))
+                walkArchive(child, visit, data);
+        }
+
+        free(child);
+        free(entries[i]);
+    }
+
+    free(entries);
+}
+
+void walkTree(const char *path, VisitFunc visit, void *data) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "error: could not open file \"%s\".\n", path);
+        return;
+    }
+
+    if (S_ISDIR(st.st_mode))
+        walkDirectory(path, visit, data);
+    else if (isArchive(path))
+        walkArchive(path, visit, data);
+    else
+        visitFile(path, visit, data);
+}
@@ -0,0 +1,34 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include <stdbool.h>
+
+/* VisitFunc: called with the path and the source, NUL terminated, of each
+ * file found by walkTree(). the source is freed after the call returns.
+ */
+typedef void (*VisitFunc)(const char *path, const char *source, void *data);
+
+/* walkTree: visit python source files under a path.
+ *
+ * @path: a file or a directory. an archive (see isArchive()) is read in
+ *      memory and each of its `.py` members is visited as `archive!member`,
+ *      any other file is visited whatever its name, and a directory is walked
+ *      recursively in name order, visiting every `.py` file and the members
+ *      of every archive in it. symbolic links to files are visited like
+ *      the files, symbolic links to directories are not followed.
+ * @visit: function called with each python file.
+ * @data: passed through to visit.
+ */
+void walkTree(const char *path, VisitFunc visit, void *data);
+
+/* readFile: read a whole file in memory.
+ *
+ * returns the contents, NUL terminated, for the caller to free, or NULL
+ * after reporting the error if the file could not be read.
+ */
+char *readFile(const char *path);
+
+/* isPythonFile: whether a file or member name ends with `.py`. */
+bool isPythonFile(const char *name);
+
+#endif
@@ -0,0 +1,172 @@
+/* benchmark of the token diff.
+ *
+ * times diffTokens() on generated pairs of sources at two sizes: unrelated
+ * sources drawn from the same small vocabulary, the worst case of a token
+ * diff, a source and a copy with a line changed every few lines, and a
+ * source and a copy laid out differently. pairs of files given on the
+ * command line are timed too. build and run with `make diffbench`.
+ *
+ * usage: diffbench [OLD NEW]...
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/diff.h"
+
+#define SMALL_LINES 8000
+#define LARGE_LINES 36000
+#define NAMES 200
+#define CHANGE_EVERY 40
+
+typedef struct {
+    char *chars;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+static void append(Buffer *buf, const char *chars) {
+    size_t length = strlen(chars);
+    if (buf->length + length + 1 > buf->capacity) {
+        while (buf->length + length + 1 > buf->capacity)
+            buf->capacity = buf->capacity ? buf->capacity * 2 : 4096;
+        buf->chars = realloc(buf->chars, buf->capacity);
+        if (!buf->chars) {
+            fputs("error: out of memory.\n", stderr);
+            exit(74);
+        }
+    }
+    memcpy(buf->chars + buf->length, chars, length + 1);
+    buf->length += length;
+}
+
+static unsigned nextRandom(unsigned *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 16 & 0x7fff;
+}
+
+/* append a line of about a dozen tokens, as random as the seed. */
+static void appendLine(Buffer *buf, unsigned *seed, const char *indent) {
+    char line[128];
+    snprintf(line, sizeof(line), "%sname_%d = name_%d(name_%d, %d) + name_%d\n",
+        indent, nextRandom(seed) % NAMES, nextRandom(seed) % NAMES,
+        nextRandom(seed) % NAMES, nextRandom(seed) % 10, nextRandom(seed) % NAMES);
+    append(buf, line);
+}
+
+/* a source of functions of a few lines each. */
+static void generate(Buffer *buf, unsigned seed, int lines, int change_every,
+    const char *indent)
+{
+    unsigned changes = seed + 1;
+    for (int i = 0; i < lines; ++i) {
+        if (i % 8 == 0) {
+            char line[64];
+            snprintf(line, sizeof(line), "def function_%d(x):\n", i / 8);
+            append(buf, line);
+        }
+        unsigned line_seed = seed * 7919u + i;
+        appendLine(buf, change_every && i % change_every == change_every / 2
+            ? &changes : &line_seed, indent);
+    }
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void timeDiff(const char *name, const char *old_source,
+    const char *new_source)
+{
+    TokenSequence old_tokens, new_tokens;
+    TokenDiff diff;
+    initTokenSequence(&old_tokens);
+    initTokenSequence(&new_tokens);
+    initTokenDiff(&diff);
+    if (!tokenizeSequence(&old_tokens, old_source)
+        || !tokenizeSequence(&new_tokens, new_source))
+    {
+        fputs("error: out of memory.\n", stderr);
+        exit(74);
+    }
+
+    double begin = now();
+    int edits = diffTokens(&diff, &old_tokens, &new_tokens);
+    double elapsed = now() - begin;
+    if (edits < 0) {
+        fputs("error: out of memory.\n", stderr);
+        exit(74);
+    }
+
+    long changed = 0;
+    for (int i = 0; i < diff.count; ++i)
+        changed += diff.edits[i].old_count + diff.edits[i].new_count;
+    printf("%-24s %8d %8d tokens %8d edits %9ld changed %9.2f ms\n", name,
+        old_tokens.count, new_tokens.count, edits, changed, elapsed * 1e3);
+
+    freeTokenDiff(&diff);
+    freeTokenSequence(&old_tokens);
+    freeTokenSequence(&new_tokens);
+}
+
+static char *readFile(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "error: could not open file \"%s\".\n", path);
+        exit(10);
+    }
+
+    fseek(file, 0L, SEEK_END);
+    size_t size = ftell(file);
+    rewind(file);
+
+    char *source = malloc(size + 1);
+    if (!source || fread(source, 1, size, file) != size) {
+        fprintf(stderr, "error: could not read file \"%s\".\n", path);
+        exit(74);
+    }
+    source[size] = '\0';
+    fclose(file);
+    return source;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc % 2 != 1) {
+        printf("usage: %s [OLD NEW]...\n", argv[0]);
+        return 64;
+    }
+
+    const int sizes[] = {SMALL_LINES, LARGE_LINES};
+    for (int i = 0; i < 2; ++i) {
+        Buffer old_source = {0}, unrelated = {0}, changed = {0}, layout = {0};
+        generate(&old_source, 1, sizes[i], 0, "    ");
+        generate(&unrelated, 1000003, sizes[i], 0, "    ");
+        generate(&changed, 1, sizes[i], CHANGE_EVERY, "    ");
+        generate(&layout, 1, sizes[i], 0, "\t");
+
+        printf("%d lines\n", sizes[i]);
+        timeDiff("unrelated", old_source.chars, unrelated.chars);
+        timeDiff("scattered changes", old_source.chars, changed.chars);
+        timeDiff("layout only", old_source.chars, layout.chars);
+
+        free(old_source.chars);
+        free(unrelated.chars);
+        free(changed.chars);
+        free(layout.chars);
+    }
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        char *old_source = readFile(argv[i]);
+        char *new_source = readFile(argv[i + 1]);
+        printf("%s %s\n", argv[i], argv[i + 1]);
+        timeDiff("files", old_source, new_source);
+        free(old_source);
+        free(new_source);
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+/* load generator for the tokenization daemon.
+ *
+ * runs concurrent clients against a daemon started with
+ * `bin/tokenize --serve SOCKET`, each sending requests for the given files
+ * in turn over its own connection, and reports the throughput and the
+ * latency percentiles of the requests. the latency of the first request of
+ * a client counts from before it connects, so waiting for the daemon to
+ * take the connection shows, and the connection latencies are reported
+ * too. the first result each client gets for a file is checked against a
+ * local scan. build with `make loadgen`.
+ *
+ * usage: loadgen [-c CLIENTS] [-n REQUESTS] [-i IDLE] [-m] SOCKET FILE...
+ *  -c CLIENTS: number of concurrent clients, 8 by default.
+ *  -n REQUESTS: number of requests per client, 1000 by default.
+ *  -i IDLE: number of connections kept open without requests meanwhile, 0
+ *      by default.
+ *  -m: send the sources in memfds instead of sending the paths.
+ */
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/client.h"
+#include "src/scanner.h"
+
+typedef struct {
+    const char *path;
+    char *source;
+    size_t length;
+} File;
+
+/* Client: the state and measurements of one client thread.
+ *
+ * @id: index of the client, used to start on a different file.
+ * @connect_latency: time taken to connect, in seconds.
+ * @latencies: the latency of each request, in seconds.
+ * @errors: number of failed or wrong requests.
+ */
+typedef struct {
+    int id;
+    double connect_latency;
+    double *latencies;
+    int errors;
+} Client;
+
+static const char *socket_path;
+static File *files;
+static int files_count;
+static int requests = 1000;
+static bool use_memfd = false;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *readFile(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "error: could not open file \"%s\".\n", path);
+        exit(10);
+    }
+
+    fseek(file, 0L, SEEK_END);
+    size_t size = ftell(file);
+    rewind(file);
+
+    char *source = malloc(size + 1);
+    if (!source || fread(source, 1, size, file) != size) {
+        fprintf(stderr, "error: could not read file \"%s\".\n", path);
+        exit(74);
+    }
+    source[size] = '\0';
+    fclose(file);
+
+    *length = size;
+    return source;
+}
+
+/* check a result against a local scan of the file. */
+static bool isCorrect(File const *file, ServeResult const *result) {
+    Scanner scanner;
+    initScanner(&scanner, file->source);
+
+    for (uint32_t i = 0; i < result->count; ++i) {
+        Token token = scanToken(&scanner);
+        if (result->types[i] != (int32_t)token.type
+            || result->offsets[i] != scanner.start - file->source
+            || result->lengths[i] != scanner.current - scanner.start
+            || result->lines[i] != token.line
+            || result->columns[i] != token.column)
+        {
+            return false;
+        }
+        if (token.type == TOKEN_ENDMARKER)
+            return i + 1 == result->count;
+    }
+
+    return false;
+}
+
+static int connectOrExit(void) {
+    int connection = connectServer(socket_path);
+    if (connection < 0) {
+        perror("error: could not connect to the daemon");
+        exit(1);
+    }
+    return connection;
+}
+
+static void *runClient(void *data) {
+    Client *client = data;
+    double begin = now();
+    int connection = connectOrExit();
+    client->connect_latency = now() - begin;
+
+    for (int i = 0; i < requests; ++i) {
+        File const *file = &files[(client->id + i) % files_count];
+        ServeResult result;
+
+        if (i > 0)
+            begin = now();
+        int error = use_memfd
+            ? tokenizeSource(connection, file->source, file->length, &result)
+            : tokenizePath(connection, file->path, &result);
+        client->latencies[i] = now() - begin;
+
+        if (error) {
+            ++client->errors;
+            continue;
+        }
+        if (i < files_count && !isCorrect(file, &result))
+            ++client->errors;
+        freeServeResult(&result);
+    }
+
+    close(connection);
+    return NULL;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+    int clients = 8;
+    int idle = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "c:n:i:m")) != -1) {
+        switch (option) {
+            case 'c':
+                clients = atoi(optarg);
+                break;
+            case 'n':
+                requests = atoi(optarg);
+                break;
+            case 'i':
+                idle = atoi(optarg);
+                break;
+            case 'm':
+                use_memfd = true;
+                break;
+            default:
+                clients = 0;
+                break;
+        }
+    }
+
+    if (clients <= 0 || requests <= 0 || idle < 0 || argc - optind < 2) {
+        printf("usage: %s [-c CLIENTS] [-n REQUESTS] [-i IDLE] [-m] "
+            "SOCKET FILE...\n", argv[0]);
+        return 64;
+    }
+
+    socket_path = argv[optind];
+    files_count = argc - optind - 1;
+    files = calloc(files_count, sizeof(File));
+    double *latencies = malloc((size_t)clients * requests * sizeof(double));
+    Client *states = calloc(clients, sizeof(Client));
+    pthread_t *threads = malloc(clients * sizeof(pthread_t));
+    double *connect_latencies = malloc(clients * sizeof(double));
+    int *idle_connections = malloc((idle ? idle : 1) * sizeof(int));
+    if (!files || !latencies || !states || !threads || !connect_latencies
+        || !idle_connections)
+    {
+        fputs("error: out of memory.\n", stderr);
+        exit(74);
+    }
+
+    for (int i = 0; i < files_count; ++i) {
+        files[i].path = argv[optind + 1 + i];
+        files[i].source = readFile(files[i].path, &files[i].length);
+    }
+
+    for (int i = 0; i < idle; ++i)
+        idle_connections[i] = connectOrExit();
+
+    double begin = now();
+    for (int i = 0; i < clients; ++i) {
+        states[i] = (Client) {
+            .id = i,
+            .latencies = latencies + (size_t)i * requests
+        };
+        if (pthread_create(&threads[i], NULL, runClient, &states[i])) {
+            fputs("error: could not start client threads.\n", stderr);
+            exit(1);
+        }
+    }
+
+    int errors = 0;
+    for (int i = 0; i < clients; ++i) {
+        pthread_join(threads[i], NULL);
+        errors += states[i].errors;
+        connect_latencies[i] = states[i].connect_latency;
+    }
+    double elapsed = now() - begin;
+    for (int i = 0; i < idle; ++i)
+        close(idle_connections[i]);
+
+    size_t total = (size_t)clients * requests;
+    qsort(latencies, total, sizeof(double), compareDoubles);
+    qsort(connect_latencies, clients, sizeof(double), compareDoubles);
+    printf("%d clients, %d idle, %zu requests (%s) in %.2f s: "
+        "%.0f requests/s\n", clients, idle, total,
+        use_memfd ? "memfd" : "path", elapsed, total / elapsed);
+    printf("connect p50 %.1f us, max %.1f us\n",
+        connect_latencies[clients / 2] * 1e6,
+        connect_latencies[clients - 1] * 1e6);
+    printf("latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+        latencies[total / 2] * 1e6, latencies[total * 99 / 100] * 1e6,
+        latencies[total - 1] * 1e6);
+    printf("%d errors\n", errors);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+/* adversarial input suite for the scanner.
+ *
+ * generates known worst cases for scanToken() and runQuery() at increasing
+ * sizes, scans or searches each one and fails if the cost per byte grows
+ * with the input size (which would indicate quadratic behaviour) or if the
+ * number of tokens is not linear in the input size. build and run with `make adversarial`, which
+ * also enables address and undefined behaviour sanitizers.
+ *
+ * usage: adversarial [-w DIR]
+ *  -w DIR: also write every generated input to DIR, e.g. to seed the fuzzer.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/query.h"
+#include "src/scanner.h"
+
+#define BASE_SIZE (1 << 16)
+#define SCALE 16
+/* allowed growth of the cost per byte between the small and large inputs.
+ * quadratic behaviour would show up as a growth of about SCALE. */
+#define MAX_GROWTH 4.0
+
+typedef struct {
+    char *chars;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+static void append(Buffer *buf, const char *chars, size_t length) {
+    if (buf->length + length + 1 > buf->capacity) {
+        while (buf->length + length + 1 > buf->capacity)
+            buf->capacity = buf->capacity ? buf->capacity * 2 : 256;
+        buf->chars = realloc(buf->chars, buf->capacity);
+        if (!buf->chars) {
+            fputs("error: out of memory.\n", stderr);
+            exit(74);
+        }
+    }
+    memcpy(buf->chars + buf->length, chars, length);
+    buf->length += length;
+    buf->chars[buf->length] = '\0';
+}
+
+static void appendString(Buffer *buf, const char *string) {
+    append(buf, string, strlen(string));
+}
+
+static void appendRepeat(Buffer *buf, char c, size_t count) {
+    while (count--)
+        append(buf, &c, 1);
+}
+
+/* generators: each one appends roughly `size` bytes of a pathological input.
+ */
+
+// newlines inside brackets used to recurse once per newline.
+static void genBracketNewlines(Buffer *buf, size_t size) {
+    appendString(buf, "x = (");
+    appendRepeat(buf, '\n', size);
+    appendString(buf, ")\n");
+}
+
+// line continuations used to recurse once per continuation.
+static void genContinuations(Buffer *buf, size_t size) {
+    appendString(buf, "x = 1");
+    for (size_t i = 0; i < size / 2; ++i)
+        appendString(buf, "\\\n");
+    appendString(buf, "\n");
+}
+
+static void genUnterminatedTripleQuote(Buffer *buf, size_t size) {
+    appendString(buf, "x = '''");
+    for (size_t i = 0; i < size / 8; ++i)
+        appendString(buf, "'' \"\"\"\n");
+}
+
+static void genUnterminatedStrings(Buffer *buf, size_t size) {
+    for (size_t i = 0; i < size / 4; ++i)
+        appendString(buf, "'\\\n");
+}
+
+// deepest possible block structure, closed all at once, over and over.
+static void genDedentCascades(Buffer *buf, size_t size) {
+    while (buf->length < size) {
+        for (int depth = 0; depth < MAX_INDENT - 1; ++depth) {
+            appendRepeat(buf, ' ', depth);
+            appendString(buf, "if x:\n");
+        }
+        appendRepeat(buf, ' ', MAX_INDENT - 1);
+        appendString(buf, "pass\n");
+        appendString(buf, "pass\n");
+    }
+}
+
+static void genIndentOverflow(Buffer *buf, size_t size) {
+    for (size_t depth = 0; buf->length < size; ++depth) {
+        appendRepeat(buf, ' ', depth % (4 * MAX_INDENT));
+        appendString(buf, "x\n");
+    }
+}
+
+static void genMixedTabs(Buffer *buf, size_t size) {
+    while (buf->length < size) {
+        appendString(buf, "if x:\n\tif y:\n\t        z\n        \tw\n");
+    }
+}
+
+static void genDeepBrackets(Buffer *buf, size_t size) {
+    appendRepeat(buf, '(', size / 2);
+    appendRepeat(buf, ']', size / 2);
+}
+
+// each `(` starts a partial match of `( ... )` one level deeper than the
+// previous ones, which used to be kept, and looked up, all at once.
+static void genNestedBrackets(Buffer *buf, size_t size) {
+    appendString(buf, "x = ");
+    appendRepeat(buf, '(', size / 2);
+    appendString(buf, "x");
+    appendRepeat(buf, ')', size / 2);
+    appendString(buf, "\n");
+}
+
+static void genCommentsAndBlankLines(Buffer *buf, size_t size) {
+    while (buf->length < size)
+        appendString(buf, "   # comment\n\t\n\n  \\\n");
+}
+
+static void genLongLexemes(Buffer *buf, size_t size) {
+    appendRepeat(buf, 'a', size / 2);
+    appendString(buf, " = ");
+    appendRepeat(buf, '1', size / 2);
+    appendString(buf, "\n");
+}
+
+static void genStrayCharacters(Buffer *buf, size_t size) {
+    while (buf->length < size)
+        appendString(buf, "!\n$?`\\ \\");
+}
+
+/* Case: a worst case, scanned, or searched with query if not NULL. */
+typedef struct {
+    const char *name;
+    void (*generate)(Buffer *buf, size_t size);
+    const char *query;
+} Case;
+
+static const Case cases[] = {
+    {"bracket_newlines", genBracketNewlines, NULL},
+    {"continuations", genContinuations, NULL},
+    {"unterminated_triple_quote", genUnterminatedTripleQuote, NULL},
+    {"unterminated_strings", genUnterminatedStrings, NULL},
+    {"dedent_cascades", genDedentCascades, NULL},
+    {"indent_overflow", genIndentOverflow, NULL},
+    {"mixed_tabs", genMixedTabs, NULL},
+    {"deep_brackets", genDeepBrackets, NULL},
+    {"comments_and_blank_lines", genCommentsAndBlankLines, NULL},
+    {"long_lexemes", genLongLexemes, NULL},
+    {"stray_characters", genStrayCharacters, NULL},
+    {"nested_brackets_query", genNestedBrackets, "( ... )"},
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* scan or search the whole buffer, returning the cost in nanoseconds per
+ * byte. the fastest of a few runs is taken to reduce noise. */
+static double scanCost(Buffer const *buf, Query *query, bool *ok) {
+    double best = -1;
+
+    for (int run = 0; run < 3; ++run) {
+        Scanner scanner;
+        size_t tokens = 0;
+        double begin = now();
+
+        if (query) {
+            runQuery(query, buf->chars, buf->length);
+        } else {
+            initScanner(&scanner, buf->chars);
+            while (scanToken(&scanner).type != TOKEN_ENDMARKER) {
+                if (++tokens > 2 * buf->length + 2) {
+                    *ok = false;
+                    return 0;
+                }
+            }
+        }
+
+        double elapsed = (now() - begin) * 1e9 / buf->length;
+        if (best < 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best;
+}
+
+static void writeInput(const char *dir, const char *name, Buffer const *buf) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.py", dir, name);
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "error: could not open file \"%s\".\n", path);
+        exit(10);
+    }
+    fwrite(buf->chars, 1, buf->length, file);
+    fclose(file);
+}
+
+int main(int argc, char *argv[]) {
+    const char *corpus_dir = NULL;
+
+    if (argc == 3 && !strcmp(argv[1], "-w")) {
+        corpus_dir = argv[2];
+    } else if (argc != 1) {
+        printf("usage: %s [-w DIR]\n", argv[0]);
+        return 64;
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); ++i) {
+        Buffer small = {0}, large = {0};
+        cases[i].generate(&small, BASE_SIZE);
+        cases[i].generate(&large, BASE_SIZE * SCALE);
+
+        Query query;
+        bool ok = true;
+        if (cases[i].query && !compileQuery(&query, cases[i].query)) {
+            fprintf(stderr, "error: %s.\n", query.error);
+            return 70;
+        }
+        Query *searched = cases[i].query ? &query : NULL;
+        double small_cost = scanCost(&small, searched, &ok);
+        double large_cost = scanCost(&large, searched, &ok);
+        if (searched)
+            freeQuery(searched);
+        double growth = large_cost / (small_cost > 0 ? small_cost : 1e-9);
+        ok = ok && growth <= MAX_GROWTH;
+
+        printf("%-28s %8zu bytes %7.2f ns/byte %8zu bytes %7.2f ns/byte  %s\n",
+            cases[i].name, small.length, small_cost,
+            large.length, large_cost, ok ? "ok" : "FAIL");
+
+        if (!ok)
+            ++failures;
+        if (corpus_dir)
+            writeInput(corpus_dir, cases[i].name, &small);
+
+        free(small.chars);
+        free(large.chars);
+    }
+
+    return failures ? 1 : 0;
+}
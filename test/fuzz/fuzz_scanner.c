@@ -0,0 +1,95 @@
+/* libFuzzer harness for the scanner.
+ *
+ * build with `make fuzz` (requires clang) and run `bin/fuzz_scanner`,
+ * optionally seeded with the corpus written by `bin/adversarial -w DIR`.
+ *
+ * every input is scanned to the end marker while checking that:
+ * - the number of tokens is linear in the input size (each token other than
+ *   a DEDENT or the final error/end marker consumes at least one byte, and
+ *   each DEDENT pairs with an earlier INDENT).
+ * - every token lexeme lies inside the source buffer and positions never go
+ *   backwards.
+ * - scanning takes at most FUZZ_BASE_NS plus FUZZ_BYTE_NS per byte, so
+ *   inputs that make the scanner superlinear show up as crashes.
+ * - the stack stays within FUZZ_STACK_SIZE: scanning runs on a thread with
+ *   a stack of that size, under the guard page of which any deep recursion
+ *   faults.
+ * address and undefined behaviour sanitizers catch everything else.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/scanner.h"
+
+/* budgets generous enough for sanitized builds on a loaded machine. */
+#define FUZZ_BASE_NS 50000000LL
+#define FUZZ_BYTE_NS 20000LL
+#define FUZZ_STACK_SIZE (256 * 1024)
+
+#define CHECK(cond) do { if (!(cond)) abort(); } while (0)
+
+static long long nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *scanInput(void *data) {
+    const char *source = data;
+    size_t length = strlen(source);
+    long long begin = nowNs();
+
+    Scanner scanner;
+    initScanner(&scanner, source);
+
+    size_t tokens = 0;
+    size_t max_tokens = 2 * length + 2;
+    int last_line = 1;
+
+    for (;;) {
+        Token token = scanToken(&scanner);
+        CHECK(++tokens <= max_tokens);
+
+        if (token.type == TOKEN_ENDMARKER)
+            break;
+
+        CHECK(token.line >= last_line);
+        last_line = token.line;
+
+        if (token.type != TOKEN_ERROR) {
+            CHECK(token.length >= 0);
+            CHECK(token.start >= source);
+            CHECK(token.start + token.length <= source + length);
+        }
+        CHECK(scanner.current <= source + length);
+    }
+
+    CHECK(nowNs() - begin <= FUZZ_BASE_NS + FUZZ_BYTE_NS * (long long)length);
+    return NULL;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char *source = malloc(size + 1);
+    if (!source)
+        return 0;
+    memcpy(source, data, size);
+    source[size] = '\0';
+
+    pthread_attr_t attr;
+    pthread_t thread;
+    CHECK(!pthread_attr_init(&attr));
+    CHECK(!pthread_attr_setstacksize(&attr, FUZZ_STACK_SIZE));
+    CHECK(!pthread_attr_setguardsize(&attr, 4096));
+    CHECK(!pthread_create(&thread, &attr, scanInput, source));
+    CHECK(!pthread_join(thread, NULL));
+    pthread_attr_destroy(&attr);
+
+    free(source);
+    return 0;
+}
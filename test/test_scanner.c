@@ -1,10 +1,31 @@
+#define _GNU_SOURCE
+
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "lib/munit/munit.h"
 
 #include "src/token.c"
+#include "src/grammar.c"
 #include "src/scanner.c"
+#include "src/filter.c"
+#include "src/checkpoint.c"
+#include "src/pytokenize.c"
+#include "src/metrics.c"
+#include "src/trivia.c"
+#include "src/structure.c"
+#include "src/fingerprint.c"
+#include "src/walk.c"
+#include "src/archive.c"
+#include "src/query.c"
+#include "src/stream.c"
+#include "src/diff.c"
+#include "src/corpus.c"
+#include "src/minify.c"
+#include "src/client.c"
+#include "src/serve.c"
 
 static MunitResult
 test_name(const MunitParameter params[], void* data) {
@@ -160,11 +181,1411 @@ test_level(const MunitParameter params[], void *data) {
     return MUNIT_OK;
 }
 
+static MunitResult
+test_dedent(const MunitParameter params[], void *data) {
+    Scanner scanner;
+    const char *source = "a:\n b:\n  c:\n   d\n e\n";
+    const TokenType expected[] = {
+        TOKEN_NAME, TOKEN_COLON, TOKEN_NEWLINE,
+        TOKEN_INDENT, TOKEN_NAME, TOKEN_COLON, TOKEN_NEWLINE,
+        TOKEN_INDENT, TOKEN_NAME, TOKEN_COLON, TOKEN_NEWLINE,
+        TOKEN_INDENT, TOKEN_NAME, TOKEN_NEWLINE,
+        // both dedents come before the name on a partially dedented line.
+        TOKEN_DEDENT, TOKEN_DEDENT, TOKEN_NAME, TOKEN_NEWLINE,
+        TOKEN_DEDENT, TOKEN_ENDMARKER
+    };
+    int count = sizeof(expected) / sizeof(*expected);
+
+    initScanner(&scanner, source);
+    for (int i = 0; i < count; ++i) {
+        Token token = scanToken(&scanner);
+        munit_assert_int(token.type, ==, expected[i]);
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_deep_input(const MunitParameter params[], void *data) {
+    Scanner scanner;
+    const int repeat = 1 << 20;
+    const char *chunks[] = {"\n", "\\\n"};
+
+    // a million insignificant newlines or line continuations in a row must
+    // not exhaust the stack.
+    for (int i = 0; i < 2; ++i) {
+        size_t chunk_len = strlen(chunks[i]);
+        char *source = malloc(chunk_len * repeat + 3);
+        munit_assert_not_null(source);
+
+        source[0] = '(';
+        for (int j = 0; j < repeat; ++j)
+            memcpy(source + 1 + j * chunk_len, chunks[i], chunk_len);
+        strcpy(source + 1 + repeat * chunk_len, ")");
+
+        initScanner(&scanner, source);
+        munit_assert_int(scanToken(&scanner).type, ==, TOKEN_LPAR);
+        Token token = scanToken(&scanner);
+        munit_assert_int(token.type, ==, TOKEN_RPAR);
+        munit_assert_int(token.line, ==, repeat + 1);
+        munit_assert_int(scanToken(&scanner).type, ==, TOKEN_ENDMARKER);
+
+        free(source);
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_filter(const MunitParameter params[], void *data) {
+    FilterScanner scanner;
+    const char *source =
+        "x = ('''import\n''', [\n"
+        "    1]); import a.b\n"
+        "if x:\n"
+        "    # import c\n"
+        "    from . import d\n";
+    const TokenType expected[] = {
+        TOKEN_IMPORT, TOKEN_NAME, TOKEN_DOT, TOKEN_NAME,
+        TOKEN_FROM, TOKEN_DOT, TOKEN_IMPORT, TOKEN_NAME,
+        TOKEN_ENDMARKER
+    };
+    const int expected_lines[] = {3, 3, 3, 3, 6, 6, 6, 6, 7};
+    int count = sizeof(expected) / sizeof(*expected);
+
+    initFilterScanner(&scanner, source);
+    tokenSetAdd(&scanner.statements, TOKEN_IMPORT);
+    tokenSetAdd(&scanner.statements, TOKEN_FROM);
+    tokenSetAdd(&scanner.tokens, TOKEN_IMPORT);
+    tokenSetAdd(&scanner.tokens, TOKEN_FROM);
+    tokenSetAdd(&scanner.tokens, TOKEN_NAME);
+    tokenSetAdd(&scanner.tokens, TOKEN_DOT);
+
+    for (int i = 0; i < count; ++i) {
+        Token token = scanFiltered(&scanner);
+        munit_assert_int(token.type, ==, expected[i]);
+        munit_assert_int(token.line, ==, expected_lines[i]);
+    }
+
+    return MUNIT_OK;
+}
+
+typedef struct {
+    Token tokens[64];
+    int count;
+} TokenBuffer;
+
+static void collectToken(Token token, void *data) {
+    TokenBuffer *buffer = data;
+    munit_assert_int(buffer->count, <, 64);
+    buffer->tokens[buffer->count++] = token;
+}
+
+static MunitResult
+test_range(const MunitParameter params[], void *data) {
+    const char *source =
+        "def f(x):\n"
+        "    if x:\n"
+        "        return (x,\n"
+        "                1)\n"
+        "    s = '''a\n"
+        "b'''\n"
+        "    return s\n"
+        "class C:\n"
+        "    pass\n"
+        "f(1)\n";
+    const int ranges[][2] = {{1, 1}, {3, 4}, {4, 6}, {6, 8}, {9, 11}};
+    CheckpointIndex index, loaded;
+
+    initCheckpointIndex(&index, source, 1);
+    buildCheckpointIndex(&index);
+    munit_assert_int(index.lines, ==, 8);
+
+    // the index survives a round trip through a file.
+    FILE *file = tmpfile();
+    munit_assert_not_null(file);
+    munit_assert_true(writeCheckpointIndex(&index, file));
+    rewind(file);
+    initCheckpointIndex(&loaded, source, 1);
+    munit_assert_true(readCheckpointIndex(&loaded, file));
+    munit_assert_int(loaded.count, ==, index.count);
+
+    // an index with no interval is refused, leaving the interval as it was.
+    CheckpointIndex corrupt;
+    fseek(file, 8, SEEK_SET);
+    fwrite("\0\0\0\0", 1, 4, file);
+    rewind(file);
+    initCheckpointIndex(&corrupt, source, 3);
+    munit_assert_false(readCheckpointIndex(&corrupt, file));
+    munit_assert_int(corrupt.interval, ==, 3);
+    munit_assert_int(corrupt.count, ==, 0);
+    fclose(file);
+
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(*ranges); ++i) {
+        int first = ranges[i][0], last = ranges[i][1];
+        TokenBuffer expected = {.count = 0}, actual = {.count = 0};
+
+        // tokens of the range as seen by a scan from the start.
+        Scanner scanner;
+        initScanner(&scanner, source);
+        for (;;) {
+            Token token = scanToken(&scanner);
+            if (token.type == TOKEN_ENDMARKER || token.line > last)
+                break;
+            int end_line = token.type == TOKEN_NEWLINE
+                ? token.line : scanner.current_line;
+            if (end_line >= first)
+                collectToken(token, &expected);
+        }
+
+        tokenizeRange(&loaded, first, last, collectToken, &actual);
+
+        munit_assert_int(actual.count, ==, expected.count);
+        for (int j = 0; j < actual.count; ++j) {
+            munit_assert_int(actual.tokens[j].type, ==, expected.tokens[j].type);
+            munit_assert_ptr_equal(actual.tokens[j].start, expected.tokens[j].start);
+            munit_assert_int(actual.tokens[j].line, ==, expected.tokens[j].line);
+            munit_assert_int(actual.tokens[j].column, ==, expected.tokens[j].column);
+        }
+    }
+
+    freeCheckpointIndex(&index);
+    freeCheckpointIndex(&loaded);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_bulk(const MunitParameter params[], void *data) {
+    const char source[] = "if x:\n    y = 'a' $ 1\n";
+    int32_t types[4], offsets[4], lengths[4], lines[4], columns[4];
+    Scanner scanner;
+    size_t index = 0;
+
+    PyTokTokenizer *tokenizer = pytokCreate(source, strlen(source));
+    munit_assert_not_null(tokenizer);
+    munit_assert_int(pytokAbiVersion(), ==, PYTOK_ABI_VERSION);
+
+    // tokenizing in small batches gives the same tokens as scanToken().
+    initScanner(&scanner, source);
+    for (;;) {
+        size_t count = pytokTokenize(tokenizer, 4,
+            types, offsets, lengths, lines, columns);
+        if (count == 0)
+            break;
+
+        for (size_t i = 0; i < count; ++i, ++index) {
+            Token token = scanToken(&scanner);
+            munit_assert_int(types[i], ==, token.type);
+            munit_assert_int(offsets[i], ==, scanner.start - source);
+            munit_assert_int(lengths[i], ==, scanner.current - scanner.start);
+            munit_assert_int(lines[i], ==, token.line);
+            munit_assert_int(columns[i], ==, token.column);
+
+            if (token.type == TOKEN_ERROR)
+                munit_assert_string_equal(pytokErrorMessage(tokenizer, index),
+                    token.start);
+            else
+                munit_assert_null(pytokErrorMessage(tokenizer, index));
+        }
+    }
+
+    munit_assert_int(types[(index - 1) % 4], ==, TOKEN_ENDMARKER);
+    munit_assert_size(index, <=, pytokMaxTokens(strlen(source)));
+    pytokDestroy(tokenizer);
+
+    // async is only a keyword from python 3.7 on.
+    const char async_source[] = "async = 1\n";
+    size_t length = strlen(async_source);
+    tokenizer = pytokCreateVersion(async_source, length, 306);
+    munit_assert_not_null(tokenizer);
+    munit_assert_size(pytokTokenize(tokenizer, 4, types, NULL, NULL, NULL,
+        NULL), ==, 4);
+    munit_assert_int(types[0], ==, TOKEN_NAME);
+    pytokDestroy(tokenizer);
+    tokenizer = pytokCreateVersion(async_source, length, 307);
+    munit_assert_not_null(tokenizer);
+    munit_assert_size(pytokTokenize(tokenizer, 4, types, NULL, NULL, NULL,
+        NULL), ==, 4);
+    munit_assert_int(types[0], ==, TOKEN_ASYNC);
+    pytokDestroy(tokenizer);
+    munit_assert_null(pytokCreateVersion(async_source, length, 305));
+    munit_assert_null(pytokCreateVersion(async_source, length, 314));
+    munit_assert_null(pytokCreateVersion(async_source, length, 3));
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_metrics(const MunitParameter params[], void *data) {
+    const char source[] =
+        "# header\n"
+        "def f(x):  # trailing\n"
+        "    return [(x, '#no')]\n"
+        "\n"
+        "n = 12\n";
+    Metrics metrics, total;
+
+    initMetrics(&metrics);
+    measureSource(&metrics, source);
+
+    munit_assert_long(metrics.files, ==, 1);
+    munit_assert_long(metrics.bytes, ==, strlen(source));
+    munit_assert_long(metrics.physical_lines, ==, 5);
+    munit_assert_long(metrics.logical_lines, ==, 3);
+    munit_assert_long(metrics.comment_lines, ==, 2);
+    munit_assert_long(metrics.comment_bytes, ==, 18);
+    munit_assert_int(metrics.max_indent, ==, 1);
+    munit_assert_int(metrics.max_level, ==, 2);
+    munit_assert_long(metrics.strings, ==, 1);
+    munit_assert_int(metrics.max_string, ==, 5);
+    munit_assert_long(metrics.numbers, ==, 1);
+    munit_assert_long(metrics.tokens[TOKEN_NAME], ==, 4);
+    munit_assert_long(metrics.tokens[TOKEN_DEDENT], ==, 1);
+
+    initMetrics(&total);
+    addMetrics(&total, &metrics);
+    addMetrics(&total, &metrics);
+    munit_assert_long(total.files, ==, 2);
+    munit_assert_long(total.comment_lines, ==, 4);
+    munit_assert_int(total.max_level, ==, 2);
+    munit_assert_long(total.tokens[TOKEN_NAME], ==, 8);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_trivia(const MunitParameter params[], void *data) {
+    const char source[] =
+        "# header\n"
+        "\n"
+        "x = (1,  # one\n"
+        "     2) \\\n"
+        "    + $\n";
+    static const TriviaType expected[] = {
+        TRIVIA_COMMENT, TRIVIA_NL, TRIVIA_NL,
+        TRIVIA_WHITESPACE, TRIVIA_WHITESPACE, TRIVIA_WHITESPACE,
+        TRIVIA_COMMENT, TRIVIA_NL, TRIVIA_WHITESPACE,
+        TRIVIA_WHITESPACE, TRIVIA_CONTINUATION, TRIVIA_WHITESPACE,
+        TRIVIA_WHITESPACE, TRIVIA_ERROR
+    };
+    char rebuilt[sizeof(source)];
+    size_t length = 0;
+    TriviaScanner scanner;
+    int trivia = 0;
+
+    initTriviaScanner(&scanner, source);
+    for (int i = 0;; ++i) {
+        Token token = scanTrivia(&scanner);
+
+        // the source is the trivia of each token followed by the token.
+        munit_assert_int(findTrivia(&scanner.table, i), ==, trivia);
+        for (; trivia < scanner.table.count; ++trivia) {
+            Trivia const *t = &scanner.table.trivia[trivia];
+            munit_assert_int(t->token, ==, i);
+            memcpy(rebuilt + length, source + t->offset, t->length);
+            length += t->length;
+        }
+        if (token.type != TOKEN_ERROR) {
+            memcpy(rebuilt + length, token.start, token.length);
+            length += token.length;
+        }
+
+        if (token.type == TOKEN_ENDMARKER)
+            break;
+    }
+
+    munit_assert_size(length, ==, strlen(source));
+    munit_assert_memory_equal(length, rebuilt, source);
+
+    munit_assert_int(scanner.table.count, ==,
+        sizeof(expected) / sizeof(*expected));
+    for (int i = 0; i < scanner.table.count; ++i)
+        munit_assert_int(scanner.table.trivia[i].type, ==, expected[i]);
+
+    freeTriviaScanner(&scanner);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_structure(const MunitParameter params[], void *data) {
+    const char source[] =
+        "if (a):\n"        // 0 IF, 1 LPAR, 2 NAME, 3 RPAR, 4 COLON, 5 NEWLINE
+        "    x = [1,\n"    // 6 INDENT, 7 NAME, 8 EQUAL, 9 LSQB, 10 NUMBER,
+                            // 11 COMMA
+        "      {}]\n"      // 12 LBRACE, 13 RBRACE, 14 RSQB, 15 NEWLINE
+        "y = (]\n";        // 16 DEDENT, 17 NAME, 18 EQUAL, 19 LPAR, 20 RSQB,
+                            // 21 NEWLINE, 22 ENDMARKER
+    static const int matches[] = {
+        -1, 3, -1, 1, -1, -1, 16, -1, -1, 14, -1, -1, 13, 12, 9, -1, 6,
+        -1, -1, -1, -1, -1, -1
+    };
+    Scanner scanner;
+    StructureIndex index;
+
+    initScanner(&scanner, source);
+    initStructureIndex(&index);
+    for (;;) {
+        Token token = scanToken(&scanner);
+        indexStructure(&index, token);
+        if (token.type == TOKEN_ENDMARKER)
+            break;
+    }
+
+    munit_assert_int(index.count, ==, sizeof(matches) / sizeof(*matches));
+    for (int i = 0; i < index.count; ++i)
+        munit_assert_int(index.matches[i], ==, matches[i]);
+
+    munit_assert_int(index.lines_count, ==, 3);
+    munit_assert_int(index.lines[0], ==, 0);
+    munit_assert_int(index.lines[1], ==, 7);
+    munit_assert_int(index.lines[2], ==, 17);
+
+    munit_assert_int(index.mismatches_count, ==, 1);
+    Mismatch const *mismatch = &index.mismatches[0];
+    munit_assert_int(mismatch->open, ==, 19);
+    munit_assert_int(mismatch->open_type, ==, TOKEN_LPAR);
+    munit_assert_int(mismatch->open_line, ==, 4);
+    munit_assert_int(mismatch->open_column, ==, 4);
+    munit_assert_int(mismatch->close, ==, 20);
+    munit_assert_int(mismatch->close_type, ==, TOKEN_RSQB);
+    munit_assert_int(mismatch->close_line, ==, 4);
+    munit_assert_int(mismatch->close_column, ==, 5);
+
+    freeStructureIndex(&index);
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_versions(const MunitParameter params[], void *data) {
+    const char source[] = "async x := a &= ~b & c\n";
+    static const TokenType expected_36[] = {
+        TOKEN_NAME, TOKEN_NAME, TOKEN_COLON, TOKEN_EQUAL, TOKEN_NAME,
+        TOKEN_AMPEREQUAL, TOKEN_TILDE, TOKEN_NAME, TOKEN_AMPER, TOKEN_NAME,
+        TOKEN_NEWLINE, TOKEN_ENDMARKER
+    };
+    static const TokenType expected_38[] = {
+        TOKEN_ASYNC, TOKEN_NAME, TOKEN_COLONEQUAL, TOKEN_NAME,
+        TOKEN_AMPEREQUAL, TOKEN_TILDE, TOKEN_NAME, TOKEN_AMPER, TOKEN_NAME,
+        TOKEN_NEWLINE, TOKEN_ENDMARKER
+    };
+    Scanner scanner;
+
+    initScannerVersion(&scanner, source, PYTHON_3_6);
+    for (size_t i = 0; i < sizeof(expected_36) / sizeof(*expected_36); ++i)
+        munit_assert_int(scanToken(&scanner).type, ==, expected_36[i]);
+
+    initScannerVersion(&scanner, source, PYTHON_3_8);
+    for (size_t i = 0; i < sizeof(expected_38) / sizeof(*expected_38); ++i)
+        munit_assert_int(scanToken(&scanner).type, ==, expected_38[i]);
+
+    // soft keywords are scanned as names in every version.
+    initScannerVersion(&scanner, "match", PYTHON_3_9);
+    munit_assert_false(isSoftKeyword(&scanner, scanToken(&scanner)));
+    initScanner(&scanner, "match type");
+    munit_assert_true(isSoftKeyword(&scanner, scanToken(&scanner)));
+    munit_assert_true(isSoftKeyword(&scanner, scanToken(&scanner)));
+    initScannerVersion(&scanner, "type", PYTHON_3_11);
+    Token token = scanToken(&scanner);
+    munit_assert_int(token.type, ==, TOKEN_NAME);
+    munit_assert_false(isSoftKeyword(&scanner, token));
+
+    return MUNIT_OK;
+}
+
+static int
+commonFingerprints(Fingerprinter const *copy, Fingerprinter const *original) {
+    int common = 0;
+    for (int i = 0; i < copy->count; ++i) {
+        for (int j = 0; j < original->count; ++j) {
+            Fingerprint const *a = &copy->fingerprints[i];
+            Fingerprint const *b = &original->fingerprints[j];
+            if (a->hash == b->hash) {
+                munit_assert_int(a->line, ==, b->line + 1);
+                ++common;
+                break;
+            }
+        }
+    }
+    return common;
+}
+
+static MunitResult
+test_fingerprint(const MunitParameter params[], void *data) {
+    const char original[] =
+        "def area(width, height):\n"
+        "    if width < 0 or height < 0:\n"
+        "        raise ValueError('negative')\n"
+        "    return width * height\n";
+    const char renamed[] =
+        "x = 1\n"
+        "def size(w, h):\n"
+        "    if w < 0 or h < 0:\n"
+        "        raise TypeError(\"bad\")\n"
+        "    return w * h\n";
+    enum { K = 5, WINDOW = 4 };
+    Fingerprinter all, winnowed;
+
+    // with a window of one every hash is selected, which gives the hashes
+    // to winnow by brute force.
+    initFingerprinter(&all, K, 1, false);
+    initFingerprinter(&winnowed, K, WINDOW, false);
+    fingerprintSource(&all, original);
+    fingerprintSource(&winnowed, original);
+
+    int count = 0;
+    int last = -1;
+    for (int right = 0; right < all.count; ++right) {
+        int min = right;
+        for (int i = right - 1; i > right - WINDOW && i >= 0; --i) {
+            if (all.fingerprints[i].hash < all.fingerprints[min].hash)
+                min = i;
+        }
+        if (min == last)
+            continue;
+
+        munit_assert_int(count, <, winnowed.count);
+        munit_assert_uint64(winnowed.fingerprints[count].hash, ==,
+            all.fingerprints[min].hash);
+        munit_assert_int(winnowed.fingerprints[count].line, ==,
+            all.fingerprints[min].line);
+        ++count;
+        last = min;
+    }
+    munit_assert_int(count, ==, winnowed.count);
+
+    // a copy with other names and literals shares fingerprints, at the
+    // same lines but one, fewer of them if names are kept.
+    Fingerprinter copy;
+    initFingerprinter(&copy, K, WINDOW, false);
+    fingerprintSource(&copy, renamed);
+    int common = commonFingerprints(&copy, &winnowed);
+    munit_assert_int(common, >, 0);
+
+    freeFingerprinter(&copy);
+    freeFingerprinter(&all);
+    initFingerprinter(&copy, K, WINDOW, true);
+    initFingerprinter(&all, K, WINDOW, true);
+    fingerprintSource(&copy, renamed);
+    fingerprintSource(&all, original);
+    munit_assert_int(commonFingerprints(&copy, &all), <, common);
+
+    freeFingerprinter(&all);
+    freeFingerprinter(&winnowed);
+    freeFingerprinter(&copy);
+
+    return MUNIT_OK;
+}
+
+/* Visited: the python files seen by a walk. */
+typedef struct {
+    int count;
+    char names[4][128];
+    char sources[4][128];
+} Visited;
+
+static void collectFile(const char *path, const char *source, void *data) {
+    Visited *visited = data;
+    munit_assert_int(visited->count, <, 4);
+    const char *name = strchr(path, '!');
+    munit_assert_not_null(name);
+    snprintf(visited->names[visited->count], 128, "%s", name + 1);
+    snprintf(visited->sources[visited->count], 128, "%s", source);
+    ++visited->count;
+}
+
+/* Ordered: the members of a walk expected to be named m0.py and on, with
+ * sources `x = 0` and on, some of them missing. */
+typedef struct {
+    int next;
+    int missing;
+    int count;
+} Ordered;
+
+static void checkOrder(const char *path, const char *source, void *data) {
+    Ordered *ordered = data;
+    if (ordered->next == ordered->missing)
+        ++ordered->next;
+    char name[32], expected[32];
+    snprintf(name, sizeof(name), "!m%d.py", ordered->next);
+    snprintf(expected, sizeof(expected), "x = %d\n", ordered->next);
+    munit_assert_not_null(strstr(path, name));
+    munit_assert_string_equal(source, expected);
+    ++ordered->next;
+    ++ordered->count;
+}
+
+/* append a member to an in-memory tar, returning the offset after it. */
+static size_t addTarMember(unsigned char *tar, size_t at, const char *name,
+    char type, const char *data, size_t size)
+{
+    unsigned char *header = tar + at;
+    size_t name_len = strlen(name);
+    memset(header, 0, TAR_BLOCK);
+    memcpy(header, name, name_len < 100 ? name_len : 100);
+    memcpy(header + 100, "0000644", 8);
+    snprintf((char *)header + 124, 12, "%011o", (unsigned)size & 07777777);
+    header[156] = type;
+    memcpy(header + 257, "ustar\0" "00", 8);
+    memset(header + 148, ' ', 8);
+    unsigned sum = 0;
+    for (int i = 0; i < TAR_BLOCK; ++i)
+        sum += header[i];
+    snprintf((char *)header + 148, 7, "%06o", sum & 0777777);
+
+    memcpy(header + TAR_BLOCK, data, size);
+    return at + TAR_BLOCK + (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+}
+
+static void putZip16(unsigned char *bytes, uint32_t value) {
+    bytes[0] = value & 0xff;
+    bytes[1] = (value >> 8) & 0xff;
+}
+
+static void putZip32(unsigned char *bytes, uint32_t value) {
+    putZip16(bytes, value & 0xffff);
+    putZip16(bytes + 2, value >> 16);
+}
+
+/* append a member to an in-memory zip, with its central directory entry
+ * appended to another buffer. returns the offset after the member. */
+static size_t addZipMember(unsigned char *zip, size_t at,
+    unsigned char *central, size_t *central_size, const char *name,
+    const char *data, bool is_deflated)
+{
+    size_t name_len = strlen(name);
+    size_t length = strlen(data);
+    uint32_t crc = crc32(0, (const Bytef *)data, length);
+    unsigned char *local = zip + at;
+    unsigned char *stored = local + ZIP_LOCAL_SIZE + name_len;
+
+    size_t compressed = length;
+    if (is_deflated) {
+        z_stream stream = {
+            .next_in = (Bytef *)data,
+            .avail_in = length,
+            .next_out = stored,
+            .avail_out = 1024
+        };
+        munit_assert_int(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED,
+            -MAX_WBITS, 8, Z_DEFAULT_STRATEGY), ==, Z_OK);
+        munit_assert_int(deflate(&stream, Z_FINISH), ==, Z_STREAM_END);
+        compressed = stream.total_out;
+        deflateEnd(&stream);
+    } else {
+        memcpy(stored, data, length);
+    }
+
+    unsigned char *entry = central + *central_size;
+    memset(local, 0, ZIP_LOCAL_SIZE);
+    memset(entry, 0, ZIP_CENTRAL_SIZE);
+    putZip32(local, 0x04034b50);
+    putZip32(entry, 0x02014b50);
+    putZip16(local + 4, 20);
+    putZip16(entry + 6, 20);
+    putZip16(local + 8, is_deflated ? Z_DEFLATED : 0);
+    putZip16(entry + 10, is_deflated ? Z_DEFLATED : 0);
+    putZip32(local + 14, crc);
+    putZip32(entry + 16, crc);
+    putZip32(local + 18, compressed);
+    putZip32(entry + 20, compressed);
+    putZip32(local + 22, length);
+    putZip32(entry + 24, length);
+    putZip16(local + 26, name_len);
+    putZip16(entry + 28, name_len);
+    putZip32(entry + 42, at);
+    memcpy(local + ZIP_LOCAL_SIZE, name, name_len);
+    memcpy(entry + ZIP_CENTRAL_SIZE, name, name_len);
+
+    *central_size += ZIP_CENTRAL_SIZE + name_len;
+    return at + ZIP_LOCAL_SIZE + name_len + compressed;
+}
+
+static void writeBytes(const char *path, const void *bytes, size_t size) {
+    FILE *file = fopen(path, "wb");
+    munit_assert_not_null(file);
+    munit_assert_size(fwrite(bytes, 1, size, file), ==, size);
+    fclose(file);
+}
+
+/* walk a path with stderr sent to a buffer. */
+static void walkCapturing(const char *path, VisitFunc visit, void *data,
+    char *errors, size_t size)
+{
+    FILE *capture = tmpfile();
+    munit_assert_not_null(capture);
+    fflush(stderr);
+    int saved = dup(STDERR_FILENO);
+    dup2(fileno(capture), STDERR_FILENO);
+
+    walkTree(path, visit, data);
+
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+    rewind(capture);
+    errors[fread(errors, 1, size - 1, capture)] = '\0';
+    fclose(capture);
+}
+
+static void walkQuietly(const char *path, Visited *visited, char *errors,
+    size_t size)
+{
+    visited->count = 0;
+    walkCapturing(path, collectFile, visited, errors, size);
+}
+
+static MunitResult
+test_archive(const MunitParameter params[], void *data) {
+    char directory[] = "/tmp/pytokenize-XXXXXX";
+    munit_assert_not_null(mkdtemp(directory));
+    char tar_path[64], tgz_path[64], cut_path[64], zip_path[64];
+    snprintf(tar_path, sizeof(tar_path), "%s/a.tar", directory);
+    snprintf(tgz_path, sizeof(tgz_path), "%s/a.tar.gz", directory);
+    snprintf(cut_path, sizeof(cut_path), "%s/cut.tar", directory);
+    snprintf(zip_path, sizeof(zip_path), "%s/a.zip", directory);
+
+    // a pax path, a GNU long name, a member skipped over and a plain one.
+    char long_name[128];
+    snprintf(long_name, sizeof(long_name), "gnu/%0100d.py", 0);
+    const char pax[] = "27 path=pax/deep/module.py\n";
+    char padding[1000];
+    memset(padding, 'z', sizeof(padding));
+
+    unsigned char *tar = calloc(16, TAR_BLOCK);
+    munit_assert_not_null(tar);
+    size_t size = addTarMember(tar, 0, "PaxHeader", 'x', pax, strlen(pax));
+    size = addTarMember(tar, size, "ignored.py", '0', "a = 1\n", 6);
+    size = addTarMember(tar, size, "././@LongLink", 'L', long_name,
+        strlen(long_name) + 1);
+    size = addTarMember(tar, size, long_name, '0', "b = 2\n", 6);
+    size_t cut = size + TAR_BLOCK + 600;
+    size = addTarMember(tar, size, "notes.txt", '0', padding,
+        sizeof(padding));
+    size = addTarMember(tar, size, "last.py", '0', "c = 3\n", 6);
+    size += 2 * TAR_BLOCK;
+    writeBytes(tar_path, tar, size);
+
+    gzFile gz = gzopen(tgz_path, "wb");
+    munit_assert_not_null(gz);
+    munit_assert_int(gzwrite(gz, tar, size), ==, (int)size);
+    gzclose(gz);
+
+    Visited visited;
+    char errors[512];
+    const char *paths[] = {tar_path, tgz_path};
+    for (int i = 0; i < 2; ++i) {
+        walkQuietly(paths[i], &visited, errors, sizeof(errors));
+        munit_assert_string_equal(errors, "");
+        munit_assert_int(visited.count, ==, 3);
+        munit_assert_string_equal(visited.names[0], "pax/deep/module.py");
+        munit_assert_string_equal(visited.sources[0], "a = 1\n");
+        munit_assert_string_equal(visited.names[1], long_name);
+        munit_assert_string_equal(visited.sources[1], "b = 2\n");
+        munit_assert_string_equal(visited.names[2], "last.py");
+    }
+
+    // an archive cut in the middle of a member skipped over.
+    writeBytes(cut_path, tar, cut);
+    walkQuietly(cut_path, &visited, errors, sizeof(errors));
+    munit_assert_int(visited.count, ==, 2);
+    munit_assert_not_null(strstr(errors, "truncated member"));
+    free(tar);
+
+    // a stored and a deflated member, found through the central directory.
+    unsigned char zip[2048], central[512];
+    size_t central_size = 0;
+    char repeated[128] = "";
+    for (int i = 0; i < 16; ++i)
+        strcat(repeated, "y = 2\n");
+    size = addZipMember(zip, 0, central, &central_size, "pkg/a.py",
+        "x = 1\n", false);
+    size = addZipMember(zip, size, central, &central_size, "pkg/b.py",
+        repeated, true);
+    // the deflated member takes less room than its source.
+    munit_assert_size(size, <, 2 * (ZIP_LOCAL_SIZE + 8) + strlen("x = 1\n")
+        + strlen(repeated));
+    memcpy(zip + size, central, central_size);
+    unsigned char *end = zip + size + central_size;
+    memset(end, 0, ZIP_END_SIZE);
+    putZip32(end, 0x06054b50);
+    putZip16(end + 8, 2);
+    putZip16(end + 10, 2);
+    putZip32(end + 12, central_size);
+    putZip32(end + 16, size);
+    writeBytes(zip_path, zip, size + central_size + ZIP_END_SIZE);
+
+    walkQuietly(zip_path, &visited, errors, sizeof(errors));
+    munit_assert_string_equal(errors, "");
+    munit_assert_int(visited.count, ==, 2);
+    munit_assert_string_equal(visited.names[0], "pkg/a.py");
+    munit_assert_string_equal(visited.sources[0], "x = 1\n");
+    munit_assert_string_equal(visited.names[1], "pkg/b.py");
+    munit_assert_string_equal(visited.sources[1], repeated);
+
+    // more members than the queue holds, inflated on several threads, are
+    // still visited in order, one that does not inflate left out.
+    unsigned char many_zip[8192], many_central[4096];
+    int members = 3 * ARCHIVE_QUEUE_SIZE;
+    central_size = 0;
+    size = 0;
+    size_t corrupt = 0;
+    for (int i = 0; i < members; ++i) {
+        char name[32], source[32];
+        snprintf(name, sizeof(name), "m%d.py", i);
+        snprintf(source, sizeof(source), "x = %d\n", i);
+        if (i == 7)
+            corrupt = size + ZIP_LOCAL_SIZE + strlen(name);
+        size = addZipMember(many_zip, size, many_central, &central_size,
+            name, source, i % 2 == 0);
+    }
+    ++many_zip[corrupt];
+    memcpy(many_zip + size, many_central, central_size);
+    end = many_zip + size + central_size;
+    memset(end, 0, ZIP_END_SIZE);
+    putZip32(end, 0x06054b50);
+    putZip16(end + 8, members);
+    putZip16(end + 10, members);
+    putZip32(end + 12, central_size);
+    putZip32(end + 16, size);
+    writeBytes(zip_path, many_zip, size + central_size + ZIP_END_SIZE);
+
+    Ordered ordered = {0, 7, 0};
+    walkCapturing(zip_path, checkOrder, &ordered, errors, sizeof(errors));
+    munit_assert_int(ordered.count, ==, members - 1);
+    munit_assert_not_null(strstr(errors, "could not inflate member"));
+    munit_assert_not_null(strstr(errors, "!m7.py"));
+
+    unlink(tar_path);
+    unlink(tgz_path);
+    unlink(cut_path);
+    unlink(zip_path);
+    rmdir(directory);
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_query(const MunitParameter params[], void *data) {
+    const char source[] =
+        "print(len(x), 'print(y)')\n"
+        "try:\n"
+        "    f(g(1), [h(2)])\n"
+        "except: pass\n";
+    Query query;
+
+    // skips balance brackets, literals only match tokens, matches from the
+    // leftmost start do not overlap.
+    munit_assert_true(compileQuery(&query, "NAME ( ... )"));
+    munit_assert_int(runQuery(&query, source, strlen(source)), ==, 2);
+    munit_assert_int(query.matches[0].offset, ==, 0);
+    munit_assert_int(query.matches[0].length, ==, 25);
+    munit_assert_int(query.matches[1].line, ==, 3);
+    munit_assert_int(query.matches[1].column, ==, 4);
+    munit_assert_int(query.matches[1].length, ==, 15);
+    freeQuery(&query);
+
+    munit_assert_true(compileQuery(&query, "'except' : ? NEWLINE"));
+    munit_assert_int(runQuery(&query, source, strlen(source)), ==, 1);
+    munit_assert_int(query.matches[0].line, ==, 4);
+    munit_assert_int(query.matches[0].length, ==, 13);
+    freeQuery(&query);
+
+    // the shortest run from a start is taken, and the search goes on after
+    // it.
+    munit_assert_true(compileQuery(&query, "a ... b"));
+    munit_assert_int(runQuery(&query, "a b b\n", 6), ==, 1);
+    munit_assert_int(query.matches[0].length, ==, 3);
+    munit_assert_int(runQuery(&query, "a x b y b\n", 10), ==, 1);
+    munit_assert_int(query.matches[0].length, ==, 5);
+    munit_assert_int(runQuery(&query, "a b x a b\n", 10), ==, 2);
+    munit_assert_int(query.matches[1].offset, ==, 6);
+    munit_assert_int(query.matches[1].length, ==, 3);
+    freeQuery(&query);
+
+    // a later start at another depth is kept, and brackets nested deeper
+    // than python allows end a `...`.
+    munit_assert_true(compileQuery(&query, "( ... )"));
+    munit_assert_int(runQuery(&query, "( ( x )\n", 8), ==, 1);
+    munit_assert_int(query.matches[0].offset, ==, 2);
+    char nested[2 * QUERY_MAX_DEPTH + 8];
+    memset(nested, '(', QUERY_MAX_DEPTH + 2);
+    memset(nested + QUERY_MAX_DEPTH + 2, ')', QUERY_MAX_DEPTH + 2);
+    strcpy(nested + 2 * QUERY_MAX_DEPTH + 4, "\n");
+    munit_assert_int(runQuery(&query, nested, strlen(nested)), ==, 1);
+    munit_assert_int(query.matches[0].offset, ==, 1);
+    munit_assert_int(query.matches[0].length, ==, 2 * QUERY_MAX_DEPTH + 2);
+    freeQuery(&query);
+
+    // the rarest literal rules sources out before scanning.
+    munit_assert_true(compileQuery(&query, "g ( ... ) , [ ... ]"));
+    munit_assert_int(query.rare_length, ==, 1);
+    munit_assert_char(query.rare[0], ==, ']');
+    munit_assert_true(queryMayMatch(&query, source, strlen(source)));
+    munit_assert_false(queryMayMatch(&query, "g(1), (2)", 9));
+    munit_assert_int(runQuery(&query, source, strlen(source)), ==, 1);
+    freeQuery(&query);
+
+    const char * const invalid[] = {"", "...", "'print", "'a b'", "#"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(*invalid); ++i) {
+        munit_assert_false(compileQuery(&query, invalid[i]));
+        munit_assert_not_null(query.error);
+        freeQuery(&query);
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_stream(const MunitParameter params[], void *data) {
+    enum { LINES = 40, MAX_TOKENS = LINES * 16 };
+    char source[LINES * 32] = "";
+    for (int i = 0; i < LINES; ++i)
+        strcat(source, i % 4 ? "    case [a, (b)]: f(b)\n" : "match x:\n");
+
+    Token expected[MAX_TOKENS];
+    int count = 0;
+    Scanner scanner;
+    initScanner(&scanner, source);
+    do {
+        expected[count] = scanToken(&scanner);
+    } while (expected[count++].type != TOKEN_ENDMARKER);
+    munit_assert_int(count, <, MAX_TOKENS);
+
+    // lookahead at a steady depth stays within the initial ring, and each
+    // token is the very one a plain scan gives.
+    TokenStream stream;
+    initTokenStream(&stream, source, PYTHON_LATEST);
+    for (int i = 0; i < count; ++i) {
+        Token ahead = peekToken(&stream, 3);
+        Token token = nextToken(&stream);
+        munit_assert_ptr_equal(token.start, expected[i].start);
+        munit_assert_int(token.type, ==, expected[i].type);
+        munit_assert_int(ahead.type, ==,
+            expected[i + 3 < count ? i + 3 : count - 1].type);
+    }
+    munit_assert_int(nextToken(&stream).type, ==, TOKEN_ENDMARKER);
+    munit_assert_size(stream.capacity, ==, TOKEN_STREAM_CAPACITY);
+    freeTokenStream(&stream);
+
+    // backtracking over more tokens than the ring holds grows it.
+    initTokenStream(&stream, source, PYTHON_LATEST);
+    nextToken(&stream);
+    size_t mark = markStream(&stream);
+    size_t inner = 0;
+    for (int i = 1; i < count - 1; ++i) {
+        if (i == 50)
+            inner = markStream(&stream);
+        munit_assert_ptr_equal(nextToken(&stream).start, expected[i].start);
+    }
+    resetStream(&stream, inner);
+    munit_assert_ptr_equal(peekToken(&stream, 0).start, expected[50].start);
+    releaseMark(&stream);
+    resetStream(&stream, mark);
+    releaseMark(&stream);
+    munit_assert_size(stream.capacity, >, TOKEN_STREAM_CAPACITY);
+    for (int i = 1; i < count; ++i) {
+        munit_assert_ptr_equal(peekToken(&stream, count).start,
+            expected[count - 1].start);
+        munit_assert_ptr_equal(nextToken(&stream).start, expected[i].start);
+    }
+    freeTokenStream(&stream);
+
+    return MUNIT_OK;
+}
+
+/* check that the edits of a diff are in order and turn the old tokens into
+ * the new ones, the tokens between them being the same in both. */
+static void assertEditsApply(TokenDiff const *diff,
+    TokenSequence const *old_tokens, TokenSequence const *new_tokens)
+{
+    int old_index = 0;
+    int new_index = 0;
+    for (int i = 0; i <= diff->count; ++i) {
+        TokenEdit edit = {old_tokens->count, 0, new_tokens->count, 0};
+        if (i < diff->count)
+            edit = diff->edits[i];
+        munit_assert_int(edit.old_start, >=, old_index);
+        munit_assert_int(edit.old_start - old_index, ==,
+            edit.new_start - new_index);
+        for (; old_index < edit.old_start; ++old_index, ++new_index) {
+            Token old_token = old_tokens->tokens[old_index];
+            Token new_token = new_tokens->tokens[new_index];
+            munit_assert_int(old_token.type, ==, new_token.type);
+            munit_assert_int(old_token.length, ==, new_token.length);
+            munit_assert_memory_equal(old_token.length, old_token.start,
+                new_token.start);
+        }
+        old_index += edit.old_count;
+        new_index += edit.new_count;
+    }
+    munit_assert_int(old_index, ==, old_tokens->count);
+    munit_assert_int(new_index, ==, new_tokens->count);
+}
+
+static MunitResult
+test_diff(const MunitParameter params[], void *data) {
+    TokenSequence old_tokens, new_tokens;
+    TokenDiff diff;
+    initTokenSequence(&old_tokens);
+    initTokenSequence(&new_tokens);
+    initTokenDiff(&diff);
+
+    // layout alone makes no difference.
+    const char *old_source = "def f(a, b):\n    return g(a)\n";
+    munit_assert_true(tokenizeSequence(&old_tokens, old_source));
+    munit_assert_true(tokenizeSequence(&new_tokens,
+        "def f(a,\n      b):  # comment\n  return g( a )\n"));
+    munit_assert_int(diffTokens(&diff, &old_tokens, &new_tokens), ==, 0);
+
+    // a renamed call and an inserted statement.
+    const char *new_source = "def f(a, b):\n    x = 1\n    return h(a)\n";
+    munit_assert_true(tokenizeSequence(&new_tokens, new_source));
+    munit_assert_int(diffTokens(&diff, &old_tokens, &new_tokens), ==, 2);
+    munit_assert_int(diff.edits[0].old_start, ==, 10);
+    munit_assert_int(diff.edits[0].old_count, ==, 0);
+    munit_assert_int(diff.edits[0].new_start, ==, 10);
+    munit_assert_int(diff.edits[0].new_count, ==, 4);
+    munit_assert_int(diff.edits[1].old_start, ==, 11);
+    munit_assert_int(diff.edits[1].old_count, ==, 1);
+    munit_assert_int(diff.edits[1].new_start, ==, 15);
+    munit_assert_int(diff.edits[1].new_count, ==, 1);
+    munit_assert_int(new_tokens.tokens[15].length, ==, 1);
+    munit_assert_char(new_tokens.tokens[15].start[0], ==, 'h');
+
+    // brackets that only differ in their type still tell apart.
+    munit_assert_true(tokenizeSequence(&old_tokens, "f(a)(b)\n"));
+    munit_assert_true(tokenizeSequence(&new_tokens, "f(a))b(\n"));
+    munit_assert_int(diffTokens(&diff, &old_tokens, &new_tokens), ==, 2);
+    munit_assert_int(diff.edits[0].old_start, ==, 4);
+    munit_assert_int(diff.edits[0].old_count, ==, 2);
+    munit_assert_int(diff.edits[0].new_count, ==, 0);
+    munit_assert_int(diff.edits[1].old_start, ==, 7);
+    munit_assert_int(diff.edits[1].new_start, ==, 5);
+    munit_assert_int(diff.edits[1].new_count, ==, 2);
+
+    // alpha and beta are found once in each source and split the search,
+    // while os, sys and log have no match and are left out of it.
+    munit_assert_true(tokenizeSequence(&old_tokens,
+        "import os\ndef alpha(x):\n    return x + 1\n"
+        "def beta(y):\n    return y * 2\n"));
+    munit_assert_true(tokenizeSequence(&new_tokens,
+        "import sys\ndef alpha(x):\n    log(x)\n    return x - 1\n"
+        "def beta(y):\n    return y * 2 + x\n"));
+    int count = diffTokens(&diff, &old_tokens, &new_tokens);
+    munit_assert_int(count, ==, 4);
+    assertEditsApply(&diff, &old_tokens, &new_tokens);
+    const char *anchors[] = {"alpha", "beta"};
+    for (int i = 0; i < 2; ++i) {
+        int anchor = 0;
+        while (old_tokens.tokens[anchor].length != (int)strlen(anchors[i])
+            || memcmp(old_tokens.tokens[anchor].start, anchors[i],
+                old_tokens.tokens[anchor].length))
+        {
+            ++anchor;
+        }
+        for (int j = 0; j < count; ++j) {
+            munit_assert_false(diff.edits[j].old_start <= anchor
+                && anchor < diff.edits[j].old_start + diff.edits[j].old_count);
+        }
+    }
+
+    freeTokenDiff(&diff);
+    freeTokenSequence(&old_tokens);
+    freeTokenSequence(&new_tokens);
+    return MUNIT_OK;
+}
+
+static MunitResult
+test_corpus(const MunitParameter params[], void *data) {
+    Corpus corpus;
+    initCorpus(&corpus, NULL, CORPUS_IDS, CORPUS_SHARD_TOKENS);
+    CorpusWorker *worker = malloc(sizeof(CorpusWorker));
+    munit_assert_not_null(worker);
+    initCorpusWorker(worker);
+    CorpusShard *shard = &corpus.shard;
+
+    // sources only differing in layout and comments are duplicates, and
+    // sources that do not tokenize are left out.
+    munit_assert_int(addDocument(&corpus, worker, "a.py", "x = f(x, 'x')\n"),
+        ==, CORPUS_ADDED);
+    munit_assert_int(addDocument(&corpus, worker, "b.py",
+        "x=f(x,'x')  # same\n"), ==, CORPUS_DUPLICATE);
+    munit_assert_int(addDocument(&corpus, worker, "c.py", "x = '\n"), ==,
+        CORPUS_INVALID);
+    munit_assert_int(addDocument(&corpus, worker, "d.py", "def f(x): 1\n"),
+        ==, CORPUS_ADDED);
+    munit_assert_uint64(corpus.documents, ==, 2);
+    munit_assert_uint64(corpus.duplicates, ==, 1);
+    munit_assert_uint64(corpus.invalid, ==, 1);
+
+    // x = f ( x , 'x' ) NEWLINE ENDMARKER, then def f ( x ) : 1 NEWLINE
+    // ENDMARKER.
+    munit_assert_uint64(shard->tokens, ==, 19);
+    munit_assert_uint32(shard->documents, ==, 2);
+    munit_assert_uint64(shard->starts[1], ==, 10);
+    munit_assert_int(shard->types[0], ==, TOKEN_NAME);
+    munit_assert_int(shard->types[9], ==, TOKEN_ENDMARKER);
+    munit_assert_int(shard->types[10], ==, TOKEN_DEF);
+    munit_assert_uint32(shard->ids[0], ==, shard->ids[4]);
+    munit_assert_uint32(shard->ids[0], ==, shard->ids[13]);
+    munit_assert_uint32(shard->ids[2], ==, shard->ids[11]);
+    munit_assert_uint32(shard->ids[0], !=, shard->ids[6]);
+    munit_assert_uint32(shard->ids[1], ==, 0);
+    munit_assert_uint32(shard->ids[10], ==, 0);
+    munit_assert_uint32(corpus.count, ==, 5);
+
+    FILE *file = tmpfile();
+    munit_assert_not_null(file);
+    munit_assert_true(writeShard(&corpus, shard, file));
+    rewind(file);
+    CorpusShardHeader header;
+    munit_assert_size(fread(&header, sizeof(header), 1, file), ==, 1);
+    munit_assert_memory_equal(4, header.magic, CORPUS_SHARD_MAGIC);
+    munit_assert_uint64(header.tokens, ==, 19);
+    munit_assert_uint64(header.ids_offset % 8, ==, 0);
+    munit_assert_uint64(header.ids_offset, >=, header.types_offset + 19);
+
+    uint64_t index[3];
+    fseek(file, (long)header.documents_offset, SEEK_SET);
+    munit_assert_size(fread(index, sizeof(uint64_t), 3, file), ==, 3);
+    munit_assert_uint64(index[1], ==, 10);
+    munit_assert_uint64(index[2], ==, 19);
+    fseek(file, (long)header.names_offset, SEEK_SET);
+    munit_assert_size(fread(index, sizeof(uint64_t), 3, file), ==, 3);
+    char names[8];
+    munit_assert_size(fread(names, 1, index[2], file), ==, 8);
+    munit_assert_memory_equal(8, names, "a.pyd.py");
+    munit_assert_long(ftell(file), ==, (long)header.size);
+    fclose(file);
+
+    freeCorpusWorker(worker);
+    free(worker);
+    freeCorpus(&corpus);
+    return MUNIT_OK;
+}
+
+static char *readBytes(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    munit_assert_not_null(file);
+    fseek(file, 0L, SEEK_END);
+    *size = ftell(file);
+    rewind(file);
+    char *bytes = malloc(*size + 1);
+    munit_assert_not_null(bytes);
+    munit_assert_size(fread(bytes, 1, *size, file), ==, *size);
+    fclose(file);
+    return bytes;
+}
+
+/* export sources named m0.py and on with 4 workers, returning the number of
+ * shards written. */
+static uint32_t exportSources(const char *directory, const char **sources,
+    int count)
+{
+    Corpus corpus;
+    initCorpus(&corpus, directory, CORPUS_IDS, 16);
+    startExport(&corpus, 4);
+    for (int i = 0; i < count; ++i) {
+        char path[16];
+        snprintf(path, sizeof(path), "m%d.py", i);
+        exportDocument(path, sources[i], &corpus);
+    }
+    munit_assert_true(finishExport(&corpus));
+    munit_assert_uint64(corpus.duplicates, ==, 2);
+    munit_assert_uint64(corpus.invalid, ==, 1);
+    uint32_t shards = corpus.shards;
+    freeCorpus(&corpus);
+    return shards;
+}
+
+static MunitResult
+test_export(const MunitParameter params[], void *data) {
+    const char *sources[] = {
+        "def f(x):\n    return g(x) + [y for y in x]\n",
+        "a = 1\n",
+        "class A:\n    b = 'b'\n",
+        "c = '\n",
+        "a=1  # the same as m1.py\n",
+        "import os\nprint(os.path.join('a', 'b'))\n",
+        "d = {1: 2, 3: 4}\n",
+        "a = 1\n\n",
+        "while x:\n    x -= 1\n",
+    };
+    int count = sizeof(sources) / sizeof(*sources);
+
+    // two exports of the same sources are the same byte for byte, the
+    // duplicates being the later copies.
+    char first[] = "/tmp/pytokenize-XXXXXX";
+    char second[] = "/tmp/pytokenize-XXXXXX";
+    munit_assert_not_null(mkdtemp(first));
+    munit_assert_not_null(mkdtemp(second));
+    uint32_t shards = exportSources(first, sources, count);
+    munit_assert_uint32(shards, >, 1);
+    munit_assert_uint32(exportSources(second, sources, count), ==, shards);
+
+    char names[256] = "";
+    for (uint32_t i = 0; i <= shards + 1; ++i) {
+        char name[32], first_path[64], second_path[64];
+        if (i < shards)
+            sprintf(name, "shard-%05u.bin", (unsigned)i);
+        else
+            strcpy(name, i == shards ? "vocabulary.bin" : "types.txt");
+        snprintf(first_path, sizeof(first_path), "%s/%s", first, name);
+        snprintf(second_path, sizeof(second_path), "%s/%s", second, name);
+
+        size_t first_size, second_size;
+        char *first_bytes = readBytes(first_path, &first_size);
+        char *second_bytes = readBytes(second_path, &second_size);
+        munit_assert_size(first_size, ==, second_size);
+        munit_assert_memory_equal(first_size, first_bytes, second_bytes);
+        if (i < shards) {
+            CorpusShardHeader header;
+            memcpy(&header, first_bytes, sizeof(header));
+            strncat(names, first_bytes + header.names_offset
+                + (header.documents + 1) * sizeof(uint64_t),
+                header.size - header.names_offset
+                    - (header.documents + 1) * sizeof(uint64_t));
+        }
+        free(first_bytes);
+        free(second_bytes);
+        unlink(first_path);
+        unlink(second_path);
+    }
+    munit_assert_string_equal(names, "m0.pym1.pym2.pym5.pym6.pym8.py");
+
+    rmdir(first);
+    rmdir(second);
+    return MUNIT_OK;
+}
+
+static void joinSlices(Minifier const *minifier, char *output, size_t size) {
+    size_t length = 0;
+    for (int i = 0; i < minifier->count; ++i) {
+        munit_assert_size(length + minifier->slices[i].iov_len, <, size);
+        memcpy(output + length, minifier->slices[i].iov_base,
+            minifier->slices[i].iov_len);
+        length += minifier->slices[i].iov_len;
+    }
+    output[length] = '\0';
+}
+
+static MunitResult
+test_minify(const MunitParameter params[], void *data) {
+    const char *source =
+        "# -*- coding: utf-8 -*-\n"
+        "\"\"\"module.\"\"\"\n"
+        "class A(B):  # comment\n"
+        "    '''doc'''\n"
+        "\n"
+        "    def f(self, x=1 .real, *args, **kwargs):\n"
+        "        return x if x else - -x\n"
+        "def g():\n"
+        "        'alone'\n"
+        "x = [1,\n"
+        "     2] + \\\n"
+        "    \"\" \"\"\n";
+    char output[256];
+
+    Minifier minifier;
+    initMinifier(&minifier, false);
+    munit_assert_true(minifySource(&minifier, source));
+    joinSlices(&minifier, output, sizeof(output));
+    munit_assert_string_equal(output,
+        "# -*- coding: utf-8 -*-\n"
+        "\"\"\"module.\"\"\"\n"
+        "class A(B):\n"
+        " '''doc'''\n"
+        " def f(self,x=1 .real,*args,**kwargs):\n"
+        "  return x if x else--x\n"
+        "def g():\n"
+        " 'alone'\n"
+        "x=[1,2]+\"\" \"\"\n");
+
+    // the source and the minified source scan the same.
+    Scanner scanner, minified;
+    initScanner(&scanner, source);
+    initScanner(&minified, output);
+    Token token, other;
+    do {
+        token = scanToken(&scanner);
+        other = scanToken(&minified);
+        munit_assert_int(other.type, ==, token.type);
+        if (token.type != TOKEN_NEWLINE && token.type != TOKEN_INDENT) {
+            munit_assert_int(other.length, ==, token.length);
+            munit_assert_memory_equal(token.length, other.start, token.start);
+        }
+    } while (token.type != TOKEN_ENDMARKER);
+    freeMinifier(&minifier);
+
+    // docstrings go, unless alone in their block.
+    initMinifier(&minifier, true);
+    munit_assert_true(minifySource(&minifier, source));
+    joinSlices(&minifier, output, sizeof(output));
+    munit_assert_string_equal(output,
+        "# -*- coding: utf-8 -*-\n"
+        "class A(B):\n"
+        " def f(self,x=1 .real,*args,**kwargs):\n"
+        "  return x if x else--x\n"
+        "def g():\n"
+        " 'alone'\n"
+        "x=[1,2]+\"\" \"\"\n");
+
+    munit_assert_false(minifySource(&minifier, "x = (1,\n"));
+    munit_assert_int(minifier.error.type, ==, TOKEN_ERROR);
+    freeMinifier(&minifier);
+
+    return MUNIT_OK;
+}
+
+/* Daemon: a daemon run in a thread of the tests. */
+typedef struct {
+    const char *socket_path;
+    int status;
+} Daemon;
+
+static void *runDaemon(void *data) {
+    Daemon *daemon = data;
+    daemon->status = serve(daemon->socket_path, 1);
+    return NULL;
+}
+
+/* connect to the daemon, waiting for it to listen. */
+static int connectDaemon(const char *socket_path) {
+    for (int i = 0; i < 1000; ++i) {
+        int connection = connectServer(socket_path);
+        if (connection >= 0)
+            return connection;
+        struct timespec pause = {0, 1000000L};
+        nanosleep(&pause, NULL);
+    }
+    return -1;
+}
+
+static void assertServed(const char *source, ServeResult const *result) {
+    Scanner scanner;
+    initScanner(&scanner, source);
+    for (uint32_t i = 0; i < result->count; ++i) {
+        Token token = scanToken(&scanner);
+        munit_assert_int(result->types[i], ==, token.type);
+        munit_assert_int(result->offsets[i], ==, scanner.start - source);
+        munit_assert_int(result->lengths[i], ==,
+            scanner.current - scanner.start);
+        munit_assert_int(result->lines[i], ==, token.line);
+        munit_assert_int(result->columns[i], ==, token.column);
+        if (token.type == TOKEN_ENDMARKER)
+            munit_assert_int(i + 1, ==, result->count);
+    }
+}
+
+static MunitResult
+test_serve(const MunitParameter params[], void *data) {
+    char directory[] = "/tmp/pytokenize-XXXXXX";
+    munit_assert_not_null(mkdtemp(directory));
+    char socket_path[64], source_path[64], missing_path[64];
+    snprintf(socket_path, sizeof(socket_path), "%s/socket", directory);
+    snprintf(source_path, sizeof(source_path), "%s/a.py", directory);
+    snprintf(missing_path, sizeof(missing_path), "%s/b.py", directory);
+    const char *source = "def f(x):\n    return x $ 1\n";
+    size_t length = strlen(source);
+    writeBytes(source_path, source, length);
+
+    // the signal that stops the daemon is only taken by its thread.
+    sigset_t signals, old_signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+    Daemon daemon = {.socket_path = socket_path, .status = -1};
+    pthread_t thread;
+    munit_assert_int(pthread_create(&thread, NULL, runDaemon, &daemon), ==, 0);
+
+    // idle connections do not hold the one worker.
+    int idle[3];
+    for (int i = 0; i < 3; ++i)
+        munit_assert_int(idle[i] = connectDaemon(socket_path), >=, 0);
+    int connection = connectDaemon(socket_path);
+    munit_assert_int(connection, >=, 0);
+
+    ServeResult result;
+    munit_assert_int(tokenizePath(connection, source_path, &result), ==, 0);
+    assertServed(source, &result);
+    munit_assert_int(result.messages_size, >, 0);
+    freeServeResult(&result);
+
+    // the same source from a memfd is found in the cache, which a source
+    // with the same hash and length does not fool.
+    munit_assert_int(tokenizeSource(connection, source, length, &result),
+        ==, 0);
+    assertServed(source, &result);
+    freeServeResult(&result);
+    ServeResponse response;
+    uint64_t hash = sourceHash(source, length);
+    int fd = findResult(hash, source, length, &response);
+    munit_assert_int(fd, >=, 0);
+    close(fd);
+    char other[64];
+    strcpy(other, source);
+    other[0] = 'D';
+    munit_assert_int(findResult(hash, other, length, &response), ==, -1);
+
+    // a memfd shorter than the length sent is read, not mapped.
+    int source_fd = memfd_create("pytokenize-test", MFD_CLOEXEC);
+    munit_assert_int(write(source_fd, source, 4), ==, 4);
+    munit_assert_int(sendRequest(connection, SERVE_MEMFD, NULL, length,
+        source_fd, &result), ==, EINVAL);
+    close(source_fd);
+
+    // bad paths and requests are answered with an error, on a connection
+    // that keeps working.
+    munit_assert_int(tokenizePath(connection, missing_path, &result),
+        ==, ENOENT);
+    munit_assert_int(tokenizePath(connection, directory, &result),
+        ==, EISDIR);
+    munit_assert_int(send(connection, "bad", 3, 0), ==, 3);
+    munit_assert_int(recv(connection, &response, sizeof(response), 0),
+        ==, sizeof(response));
+    munit_assert_int(response.status, ==, EINVAL);
+    munit_assert_int(tokenizePath(connection, source_path, &result), ==, 0);
+    freeServeResult(&result);
+
+    close(connection);
+    for (int i = 0; i < 3; ++i)
+        close(idle[i]);
+    pthread_kill(thread, SIGTERM);
+    pthread_join(thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    munit_assert_int(daemon.status, ==, 0);
+    munit_assert_int(access(socket_path, F_OK), ==, -1);
+
+    unlink(source_path);
+    rmdir(directory);
+    return MUNIT_OK;
+}
+
 static MunitTest test_suite_tests[] = {
     {"name test", test_name, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"string test", test_string, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"number test", test_number, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"level test", test_level, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"dedent test", test_dedent, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"deep input test", test_deep_input, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"filter test", test_filter, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"range test", test_range, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"bulk test", test_bulk, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"metrics test", test_metrics, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"trivia test", test_trivia, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"structure test", test_structure, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"versions test", test_versions, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"fingerprint test", test_fingerprint, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"archive test", test_archive, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"query test", test_query, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"stream test", test_stream, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"diff test", test_diff, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"corpus test", test_corpus, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"export test", test_export, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"minify test", test_minify, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"serve test", test_serve, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
 };
 
@@ -0,0 +1,349 @@
+#!/usr/bin/env python3
+"""generate the token and grammar tables of the scanner.
+
+reads grammar/Tokens and grammar/Keywords and writes src/token.h,
+src/token.c, src/grammar.h and src/grammar.c. run from the repository root,
+the makefile does so whenever one of the inputs changes.
+"""
+
+import sys
+
+VERSIONS = [(3, minor) for minor in range(6, 14)]
+
+HEADER = "/* AUTO-GENERATED DO NOT MODIFY. see tools/generate_tokens.py. */\n"
+
+
+def parse_version(text, path, number):
+    try:
+        major, minor = text.split(".")
+        version = (int(major), int(minor))
+    except ValueError:
+        sys.exit("%s:%d: bad version %r" % (path, number, text))
+    if version not in VERSIONS:
+        sys.exit("%s:%d: unsupported version %r" % (path, number, text))
+    return version
+
+
+def read_lines(path):
+    with open(path) as file:
+        for number, line in enumerate(file, 1):
+            fields = line.split("#", 1)[0].split()
+            if fields:
+                yield number, fields
+
+
+def read_tokens(path):
+    """return a list of (name, display name, operator, first version)."""
+    tokens = []
+    for number, fields in read_lines(path):
+        display = fields[0]
+        name = display.strip("<>")
+        operator = None
+        version = VERSIONS[0]
+        if len(fields) > 1:
+            if len(fields[1]) < 3 or fields[1][0] != "'" or fields[1][-1] != "'":
+                sys.exit("%s:%d: bad operator %r" % (path, number, fields[1]))
+            operator = fields[1][1:-1]
+        if len(fields) > 2:
+            version = parse_version(fields[2], path, number)
+        tokens.append((name, display, operator, version))
+    return tokens
+
+
+def read_keywords(path, token_names):
+    """return a list of (spelling, token name or None if soft, version)."""
+    keywords = []
+    for number, fields in read_lines(path):
+        spelling, token = fields[0], fields[1]
+        version = VERSIONS[0]
+        if len(fields) > 2:
+            version = parse_version(fields[2], path, number)
+        if token == "soft":
+            token = None
+        elif token not in token_names:
+            sys.exit("%s:%d: unknown token %r" % (path, number, token))
+        keywords.append((spelling, token, version))
+    return keywords
+
+
+def group_versions(items_for):
+    """group the versions with the same items, returning (first version,
+    items) pairs in version order and the group index of each version."""
+    groups = []
+    group_of = []
+    for version in VERSIONS:
+        items = items_for(version)
+        for i, (_, group_items) in enumerate(groups):
+            if group_items == items:
+                group_of.append(i)
+                break
+        else:
+            group_of.append(len(groups))
+            groups.append((version, items))
+    return groups, group_of
+
+
+def version_suffix(version):
+    return "%d%d" % version
+
+
+def c_char(char):
+    return "'%s'" % char.replace("\\", "\\\\").replace("'", "\\'")
+
+
+def c_string(text):
+    return '"%s"' % text.replace("\\", "\\\\").replace('"', '\\"')
+
+
+def generate_token_h(tokens):
+    lines = ["#ifndef TOKEN_H", "#define TOKEN_H", "", HEADER.rstrip(),
+             "typedef enum {"]
+    lines += ["    TOKEN_%s," % name for name, _, _, _ in tokens]
+    lines += [
+        "    TOKEN_COUNT",
+        "} TokenType;",
+        "",
+        "/* Token: represents a token.",
+        " *",
+        " * @type: token type.",
+        " * @start: a pointer to the start of the token lexeme in the source string.",
+        " * @length: length of the token lexeme.",
+        " * @line: line at which the token lexeme starts.",
+        " * @column: column at which the token lexeme starts.",
+        " */",
+        "typedef struct {",
+        "    TokenType type;",
+        "    const char *start;",
+        "    int length;",
+        "    int line, column;",
+        "} Token;",
+        "",
+        "/* table of token names */",
+        "extern const char * const Token_Names[];",
+        "",
+        "#endif",
+    ]
+    return "\n".join(lines) + "\n"
+
+
+def generate_token_c(tokens):
+    lines = [
+        "#include <stdio.h>",
+        "",
+        '#include "token.h"',
+        "",
+        "/* one-to-one correspondence with enum TokenType",
+        " * AUTO-GENERATED DO NOT MODIFY */",
+        "const char * const Token_Names[] = {",
+    ]
+    lines += ["    %s," % c_string(display) for _, display, _, _ in tokens]
+    lines += ["};"]
+    return "\n".join(lines) + "\n"
+
+
+def build_dfa(operators, classes):
+    """build the trie of operators as a DFA. return the transitions of each
+    state, indexed by character class, and the token accepted in each state,
+    or None."""
+    transitions = [[0] * (len(classes) + 1)]
+    accept = [None]
+    for spelling, token in sorted(operators):
+        state = 0
+        for char in spelling:
+            char_class = classes[char]
+            if not transitions[state][char_class]:
+                transitions.append([0] * (len(classes) + 1))
+                accept.append(None)
+                transitions[state][char_class] = len(transitions) - 1
+            state = transitions[state][char_class]
+        accept[state] = token
+    if len(transitions) > 256:
+        sys.exit("too many operator states")
+    return transitions, accept
+
+
+def generate_grammar_h(class_count):
+    lines = [
+        "#ifndef GRAMMAR_H",
+        "#define GRAMMAR_H",
+        "",
+        HEADER.rstrip(),
+        "",
+        "#include <stdbool.h>",
+        "",
+        '#include "token.h"',
+        "",
+        "typedef enum {",
+    ]
+    lines += ["    PYTHON_%d_%d," % version for version in VERSIONS]
+    lines += [
+        "    PYTHON_VERSION_COUNT",
+        "} PythonVersion;",
+        "",
+        "#define PYTHON_LATEST PYTHON_%d_%d" % VERSIONS[-1],
+        "",
+        "/* number of operator character classes, class 0 is for characters",
+        " * that are not part of any operator. */",
+        "#define OPERATOR_CLASSES %d" % class_count,
+        "",
+        "/* Grammar: the lexical grammar of a python version.",
+        " *",
+        " * @keyword: return the keyword type of a name, or TOKEN_NAME.",
+        " * @is_soft_keyword: return true if a name is a soft keyword.",
+        " * @operator_next: operator DFA transitions, from a state and the class",
+        " *      of the next character to the next state, or 0 if there is none.",
+        " *      the DFA starts in state 0.",
+        " * @operator_accept: type of the operator ending in each state, or",
+        " *      TOKEN_ERROR.",
+        " */",
+        "typedef struct {",
+        "    TokenType (*keyword)(const char *name, int length);",
+        "    bool (*is_soft_keyword)(const char *name, int length);",
+        "    const unsigned char (*operator_next)[OPERATOR_CLASSES];",
+        "    const unsigned char *operator_accept;",
+        "} Grammar;",
+        "",
+        "/* class of each character in the operator DFA. */",
+        "extern const unsigned char Operator_Classes[256];",
+        "",
+        "/* grammar of each python version. */",
+        "extern const Grammar Grammars[PYTHON_VERSION_COUNT];",
+        "",
+        "/* name of each python version, as in \"3.6\". */",
+        "extern const char * const Python_Version_Names[PYTHON_VERSION_COUNT];",
+        "",
+        "#endif",
+    ]
+    return "\n".join(lines) + "\n"
+
+
+def generate_lookup(name, return_type, keywords, found, not_found):
+    lines = ["static %s %s(const char *name, int length) {" % (return_type, name)]
+    by_length = {}
+    for spelling, value in keywords:
+        by_length.setdefault(len(spelling), []).append((spelling, value))
+    if by_length:
+        lines.append("    switch (length) {")
+        for length in sorted(by_length):
+            lines.append("        case %d:" % length)
+            for spelling, value in sorted(by_length[length]):
+                lines.append("            if (!memcmp(name, %s, %d))"
+                             % (c_string(spelling), length))
+                lines.append("                return %s;" % found(value))
+            lines.append("            break;")
+        lines.append("    }")
+    lines.append("    return %s;" % not_found)
+    lines.append("}")
+    return lines
+
+
+def generate_grammar_c(tokens, keywords, classes):
+    def keywords_for(version):
+        return tuple(sorted((spelling, token)
+                            for spelling, token, first in keywords
+                            if token and first <= version))
+
+    def soft_keywords_for(version):
+        return tuple(sorted(spelling for spelling, token, first in keywords
+                            if not token and first <= version))
+
+    def operators_for(version):
+        return tuple(sorted((operator, name)
+                            for name, _, operator, first in tokens
+                            if operator and first <= version))
+
+    keyword_groups, keyword_of = group_versions(keywords_for)
+    soft_groups, soft_of = group_versions(soft_keywords_for)
+    operator_groups, operator_of = group_versions(operators_for)
+
+    lines = [
+        "#include <stdbool.h>",
+        "#include <string.h>",
+        "",
+        '#include "grammar.h"',
+        "",
+        HEADER.rstrip(),
+        "",
+        "const unsigned char Operator_Classes[256] = {",
+    ]
+    for char, char_class in sorted(classes.items(), key=lambda item: item[1]):
+        lines.append("    [%s] = %d," % (c_char(char), char_class))
+    lines += ["};", ""]
+
+    for version, items in keyword_groups:
+        lines += generate_lookup(
+            "keywordType%s" % version_suffix(version), "TokenType", items,
+            lambda token: "TOKEN_" + token, "TOKEN_NAME")
+        lines.append("")
+
+    for version, items in soft_groups:
+        lines += generate_lookup(
+            "isSoftKeyword%s" % version_suffix(version), "bool",
+            [(spelling, None) for spelling in items],
+            lambda value: "true", "false")
+        lines.append("")
+
+    for version, items in operator_groups:
+        transitions, accept = build_dfa(items, classes)
+        suffix = version_suffix(version)
+        lines.append("static const unsigned char operator_next%s[][%d] = {"
+                     % (suffix, len(classes) + 1))
+        for row in transitions:
+            lines.append("    {%s}," % ", ".join(str(state) for state in row))
+        lines += ["};", ""]
+        lines.append("static const unsigned char operator_accept%s[] = {"
+                     % suffix)
+        for token in accept:
+            if token:
+                lines.append("    TOKEN_%s," % token)
+            else:
+                lines.append("    TOKEN_ERROR,")
+        lines += ["};", ""]
+
+    lines.append("const Grammar Grammars[PYTHON_VERSION_COUNT] = {")
+    for i, version in enumerate(VERSIONS):
+        keyword = version_suffix(keyword_groups[keyword_of[i]][0])
+        soft = version_suffix(soft_groups[soft_of[i]][0])
+        operator = version_suffix(operator_groups[operator_of[i]][0])
+        lines += [
+            "    [PYTHON_%d_%d] = {" % version,
+            "        .keyword = keywordType%s," % keyword,
+            "        .is_soft_keyword = isSoftKeyword%s," % soft,
+            "        .operator_next = operator_next%s," % operator,
+            "        .operator_accept = operator_accept%s" % operator,
+            "    },",
+        ]
+    lines += ["};", ""]
+
+    lines.append("const char * const Python_Version_Names[PYTHON_VERSION_COUNT] = {")
+    lines += ['    "%d.%d",' % version for version in VERSIONS]
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def write(path, text):
+    with open(path, "w") as file:
+        file.write(text)
+
+
+def main():
+    tokens = read_tokens("grammar/Tokens")
+    names = {name for name, _, _, _ in tokens}
+    if len(names) != len(tokens):
+        sys.exit("grammar/Tokens: duplicate token")
+    if len(tokens) > 256:
+        sys.exit("grammar/Tokens: operator tables hold token types in a byte")
+    keywords = read_keywords("grammar/Keywords", names)
+
+    chars = sorted({char for _, _, operator, _ in tokens if operator
+                    for char in operator})
+    classes = {char: i + 1 for i, char in enumerate(chars)}
+
+    write("src/token.h", generate_token_h(tokens))
+    write("src/token.c", generate_token_c(tokens))
+    write("src/grammar.h", generate_grammar_h(len(classes) + 1))
+    write("src/grammar.c", generate_grammar_c(tokens, keywords, classes))
+
+
+if __name__ == "__main__":
+    main()